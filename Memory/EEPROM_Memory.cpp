@@ -12,13 +12,13 @@ void EEPROM_Memory::init(void)
 }
 
 
-uint16_t EEPROM_Memory::read(uint8_t* data_ptr, uint16_t start, uint16_t len) 
+MemoryAddress_t EEPROM_Memory::read(uint8_t* data_ptr, MemoryAddress_t start, MemoryAddress_t len) 
 {
     return EEPROM.readBytes(start,data_ptr,len);
 }
 
 
-uint16_t EEPROM_Memory::write(uint8_t* data_ptr, uint16_t start, uint16_t len)
+MemoryAddress_t EEPROM_Memory::write(uint8_t* data_ptr, MemoryAddress_t start, MemoryAddress_t len)
 {
     
     return EEPROM.writeBytes(start,data_ptr,len);
@@ -14,8 +14,8 @@ class EEPROM_Memory : public Memory
     public:
         EEPROM_Memory(EEPROM_Memory_Config_t &config);
         void init(void);
-        uint16_t read(uint8_t* data_ptr, uint16_t start, uint16_t len);
-        uint16_t write(uint8_t* data_ptr, uint16_t start, uint16_t len);
+        MemoryAddress_t read(uint8_t* data_ptr, MemoryAddress_t start, MemoryAddress_t len);
+        MemoryAddress_t write(uint8_t* data_ptr, MemoryAddress_t start, MemoryAddress_t len);
         bool commit(void); 
 
     private:
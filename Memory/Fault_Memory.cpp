@@ -0,0 +1,329 @@
+#include <string.h>
+#include "Fault_Memory.h"
+#include "MemoryManager_Debug.h"
+
+Fault_Memory::Fault_Memory(Fault_Memory_Config_t &config) : Memory(),
+                                                            m_config(&config),
+                                                            m_stats{},
+                                                            m_cut_writes(0),
+                                                            m_cut_bytes(0),
+                                                            m_cut_commits(0),
+                                                            m_flip_interval(0),
+                                                            m_flip_countdown(0),
+                                                            m_random((config.seed != 0) ? config.seed : 0x2545F491u),
+                                                            m_cut_address(0),
+                                                            m_powered(true)
+{
+}
+
+void Fault_Memory::init(void)
+{
+    if (m_powered)
+    {
+        m_config->memory->init();
+    }
+}
+
+MemoryAddress_t Fault_Memory::read(uint8_t* data_ptr, MemoryAddress_t start, MemoryAddress_t len)
+{
+    return m_powered ? m_config->memory->read(data_ptr, start, len) : 0;
+}
+
+MemoryAddress_t Fault_Memory::write(uint8_t* data_ptr, MemoryAddress_t start, MemoryAddress_t len)
+{
+    MemoryAddress_t keep = len;
+    bool cut_now = false;
+
+    if ((m_powered == false) || (data_ptr == NULL) || (len == 0))
+    {
+        return 0;
+    }
+
+    /* The caller's buffer is the memory mirror, flips go into a copy */
+    if ((m_flip_interval != 0) && (--m_flip_countdown == 0))
+    {
+        m_flip_countdown = m_flip_interval;
+        m_buffer.assign(data_ptr, data_ptr + len);
+        m_buffer[random() % len] ^= (1u << (random() % 8u));
+        data_ptr = m_buffer.data();
+        m_stats.bit_flips++;
+    }
+
+    if ((m_cut_writes != 0) && (--m_cut_writes == 0))
+    {
+        keep = random() % len;
+        cut_now = true;
+    }
+    if (m_cut_bytes != 0)
+    {
+        if (m_cut_bytes <= len)
+        {
+            keep = (m_cut_bytes < keep) ? m_cut_bytes : keep;
+            cut_now = true;
+        }
+        m_cut_bytes = cut_now ? 0 : (m_cut_bytes - len);
+    }
+
+    m_stats.writes++;
+    if (cut_now)
+    {
+        return cut(data_ptr, start, len, keep);
+    }
+
+    if (m_config->lose_uncommitted)
+    {
+        save_undo(start, len);
+    }
+    m_stats.bytes_written += len;
+    return m_config->memory->write(data_ptr, start, len);
+}
+
+bool Fault_Memory::commit(void)
+{
+    bool ret;
+
+    if (m_powered && (m_cut_commits != 0) && (--m_cut_commits == 0))
+    {
+        cut_commit();
+        return false;
+    }
+
+    ret = m_powered && m_config->memory->commit();
+
+    if (ret)
+    {
+        m_stats.commits++;
+        m_undo.clear();
+    }
+    return ret;
+}
+
+bool Fault_Memory::commit_range(MemoryAddress_t start, MemoryAddress_t len)
+{
+    std::vector<Fault_Undo_t> inside;
+    bool ret;
+
+    /* m_undo keeps the writes outside of the range */
+    split_undo(start, len, inside);
+
+    if (m_powered && (m_cut_commits != 0) && (--m_cut_commits == 0))
+    {
+        roll_back(0);
+        m_undo.swap(inside);
+        cut_commit();
+        return false;
+    }
+
+    ret = m_powered && m_config->memory->commit_range(start, len);
+
+    if (ret)
+    {
+        m_stats.commits++;
+    }
+    else
+    {
+        /* Nothing committed, the writes of the range stay uncommitted (they do not overlap the others) */
+        inside.insert(inside.end(), m_undo.begin(), m_undo.end());
+        m_undo.swap(inside);
+    }
+    return ret;
+}
+
+void Fault_Memory::cut_after_writes(uint32_t writes)
+{
+    m_cut_writes = writes;
+}
+
+void Fault_Memory::cut_after_bytes(uint32_t bytes)
+{
+    m_cut_bytes = bytes;
+}
+
+void Fault_Memory::cut_at_commit(uint32_t commits)
+{
+    m_cut_commits = commits;
+}
+
+void Fault_Memory::bit_flip_interval(uint32_t writes)
+{
+    m_flip_interval = writes;
+    m_flip_countdown = writes;
+}
+
+bool Fault_Memory::flip_bit(MemoryAddress_t address, uint8_t bit)
+{
+    uint8_t value;
+    bool ret = (m_config->memory->read(&value, address, 1) == 1);
+
+    if (ret)
+    {
+        value ^= (1u << (bit % 8u));
+        ret = (m_config->memory->write(&value, address, 1) == 1) && m_config->memory->commit();
+        m_stats.bit_flips += ret ? 1u : 0u;
+    }
+    return ret;
+}
+
+void Fault_Memory::power_on(void)
+{
+    m_powered = true;
+    m_cut_writes = 0;
+    m_cut_bytes = 0;
+    m_cut_commits = 0;
+    m_undo.clear();
+}
+
+void Fault_Memory::reset_stats(void)
+{
+    m_stats = Fault_Memory_Stats_t{};
+}
+
+MemoryAddress_t Fault_Memory::cut(uint8_t* data_ptr, MemoryAddress_t start, MemoryAddress_t len, MemoryAddress_t keep)
+{
+    /* The cache is lost, but the interrupted write still leaves its torn page behind */
+    if (m_config->lose_uncommitted)
+    {
+        roll_back(0);
+    }
+
+    if (keep > 0)
+    {
+        m_config->memory->write(data_ptr, start, keep);
+        m_stats.bytes_written += keep;
+    }
+    tear(start + keep, start + len);
+    m_config->memory->commit();
+
+    DBIF_LOG_DEBUG_0("Power cut at %i (%i of %i bytes written)", start + keep, keep, len);
+    power_off(start + keep);
+    return 0;
+}
+
+void Fault_Memory::cut_commit(void)
+{
+    MemoryAddress_t address = 0;
+    MemoryAddress_t keep;
+    uint32_t torn;
+
+    /* The commit programs the uncommitted writes in order and stops inside a random one */
+    if (m_config->lose_uncommitted && (m_undo.size() > 0))
+    {
+        torn = random() % m_undo.size();
+        roll_back(torn + 1u);
+
+        Fault_Undo_t &undo = m_undo[torn];
+        keep = random() % undo.data.size();
+        m_config->memory->write(undo.data.data() + keep, undo.start + keep, undo.data.size() - keep);
+        m_stats.lost_bytes += undo.data.size() - keep;
+        tear(undo.start + keep, undo.start + undo.data.size());
+        address = undo.start + keep;
+    }
+    m_config->memory->commit();
+    m_undo.clear();
+
+    DBIF_LOG_DEBUG_0("Power cut during commit at %i", address);
+    power_off(address);
+}
+
+void Fault_Memory::tear(MemoryAddress_t start, MemoryAddress_t end)
+{
+    MemoryAddress_t page_end;
+
+    /* The page being programmed is left in an undefined state */
+    if ((m_config->page_size == 0) || (start >= end))
+    {
+        return;
+    }
+
+    page_end = (start / m_config->page_size + 1u) * m_config->page_size;
+    end = (page_end < end) ? page_end : end;
+    m_buffer.resize(end - start);
+    for (uint8_t &value : m_buffer)
+    {
+        value = static_cast<uint8_t>(random());
+    }
+    m_config->memory->write(m_buffer.data(), start, m_buffer.size());
+    m_stats.torn_bytes += m_buffer.size();
+}
+
+void Fault_Memory::power_off(MemoryAddress_t address)
+{
+    m_cut_address = address;
+    m_stats.cuts++;
+    m_powered = false;
+    m_cut_writes = 0;
+    m_cut_bytes = 0;
+    m_cut_commits = 0;
+}
+
+void Fault_Memory::save_undo(MemoryAddress_t start, MemoryAddress_t len)
+{
+    Fault_Undo_t undo;
+
+    undo.start = start;
+    undo.data.resize(len);
+    if (m_config->memory->read(undo.data.data(), start, len) == len)
+    {
+        m_undo.push_back(undo);
+    }
+}
+
+void Fault_Memory::roll_back(uint32_t first)
+{
+    /* Newest first, overlapping writes end up with the content before entry first */
+    while (m_undo.size() > first)
+    {
+        Fault_Undo_t &undo = m_undo.back();
+        m_config->memory->write(undo.data.data(), undo.start, undo.data.size());
+        m_stats.lost_bytes += undo.data.size();
+        m_undo.pop_back();
+    }
+}
+
+void Fault_Memory::split_undo(MemoryAddress_t start, MemoryAddress_t len, std::vector<Fault_Undo_t> &inside)
+{
+    std::vector<Fault_Undo_t> outside;
+    uint64_t end = (uint64_t)start + len;
+    uint64_t undo_end, from, to;
+    Fault_Undo_t part;
+
+    /* A write crossing the range is cut into its parts, the order of the writes is kept */
+    for (Fault_Undo_t &undo : m_undo)
+    {
+        undo_end = (uint64_t)undo.start + undo.data.size();
+        from = (undo.start > start) ? undo.start : start;
+        to = (undo_end < end) ? undo_end : end;
+
+        if (from >= to)
+        {
+            outside.push_back(undo);
+            continue;
+        }
+
+        if (undo.start < from)
+        {
+            part.start = undo.start;
+            part.data.assign(undo.data.begin(), undo.data.begin() + (from - undo.start));
+            outside.push_back(part);
+        }
+        part.start = (MemoryAddress_t)from;
+        part.data.assign(undo.data.begin() + (from - undo.start), undo.data.begin() + (to - undo.start));
+        inside.push_back(part);
+        if (to < undo_end)
+        {
+            part.start = (MemoryAddress_t)to;
+            part.data.assign(undo.data.begin() + (to - undo.start), undo.data.end());
+            outside.push_back(part);
+        }
+    }
+    m_undo.swap(outside);
+}
+
+uint32_t Fault_Memory::random(void)
+{
+    /* xorshift32, reproducible for a given seed */
+    m_random ^= m_random << 13;
+    m_random ^= m_random >> 17;
+    m_random ^= m_random << 5;
+    return m_random;
+}
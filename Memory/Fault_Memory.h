@@ -0,0 +1,147 @@
+#ifndef FAULT_MEMORY_H
+#define FAULT_MEMORY_H
+#include <vector>
+#include "Memory.h"
+
+struct Fault_Memory_Config_t
+{
+    Memory *memory;             /**< Device the requests are passed to. */
+    uint32_t page_size;         /**< Program granularity, a cut leaves the rest of the interrupted page undefined. 0: byte granular. */
+    bool lose_uncommitted;      /**< A cut also discards everything written since the last commit (write back caches, emulated EEPROM). */
+    uint32_t seed;              /**< Seed of the pseudo random cut positions, torn bytes and bit flips. */
+};
+
+struct Fault_Memory_Stats_t
+{
+    uint32_t writes;            /**< Write requests passed to the device. */
+    uint32_t bytes_written;     /**< Bytes passed to the device. */
+    uint32_t commits;           /**< Successful commits. */
+    uint32_t cuts;              /**< Injected power cuts. */
+    uint32_t torn_bytes;        /**< Bytes left undefined by torn page writes. */
+    uint32_t lost_bytes;        /**< Uncommitted bytes rolled back by a cut. */
+    uint32_t bit_flips;         /**< Injected bit flips. */
+};
+
+/**
+ * @class Fault_Memory
+ * @brief Memory wrapper injecting power cuts, torn writes and bit flips, for
+ *        recovery tests on the host or on the target.
+ *
+ * A power cut is armed with cut_after_writes() or cut_after_bytes(). The
+ * write reaching the limit is only partially passed to the device, the rest
+ * of the interrupted page is filled with random bytes. From then on every
+ * request fails until power_on() is called, which models the reboot; the
+ * MemoryManager has to be constructed and started again afterwards. With
+ * lose_uncommitted the cut also rolls the device back to the last commit,
+ * the torn page of the interrupted write remains.
+ *
+ * cut_at_commit() cuts the power inside a commit. With lose_uncommitted the
+ * uncommitted writes are persisted in order up to a random one, which is
+ * torn; a device without lose_uncommitted holds all writes already and
+ * only loses power. commit_range() only commits the writes inside the
+ * range, the others stay uncommitted; a cut inside it loses them and
+ * persists the writes of the range like cut_at_commit().
+ *
+ * All requests are executed synchronously, the asynchronous calls use the
+ * default implementations of Memory.
+ */
+class Fault_Memory : public Memory
+{
+
+    public:
+        Fault_Memory(Fault_Memory_Config_t &config);
+        void init(void);
+        MemoryAddress_t read(uint8_t* data_ptr, MemoryAddress_t start, MemoryAddress_t len);
+        MemoryAddress_t write(uint8_t* data_ptr, MemoryAddress_t start, MemoryAddress_t len);
+        bool commit(void);
+        bool commit_range(MemoryAddress_t start, MemoryAddress_t len);
+
+        /**
+         * @brief Cuts the power during the given write request from now on.
+         * @param writes Number of the write request, 1 for the next one, 0 disarms.
+         */
+        void cut_after_writes(uint32_t writes);
+
+        /**
+         * @brief Cuts the power once the given number of bytes was written from now on.
+         * @param bytes Number of bytes which still reach the device, 0 disarms.
+         */
+        void cut_after_bytes(uint32_t bytes);
+
+        /**
+         * @brief Cuts the power during the given commit from now on, the commit fails.
+         * @param commits Number of the commit, 1 for the next one, 0 disarms.
+         */
+        void cut_at_commit(uint32_t commits);
+
+        /**
+         * @brief Flips one random bit of every n-th write request before it reaches the device.
+         * @param writes Interval in write requests, 0 disables.
+         */
+        void bit_flip_interval(uint32_t writes);
+
+        /**
+         * @brief Flips one bit of the device content.
+         * @param address Address of the byte.
+         * @param bit Number of the bit (0-7).
+         * @return True if the byte could be read and written.
+         */
+        bool flip_bit(MemoryAddress_t address, uint8_t bit);
+
+        /**
+         * @brief Restores the power after a cut and disarms the pending faults.
+         */
+        void power_on(void);
+
+        /**
+         * @brief Returns false between a power cut and power_on().
+         */
+        bool powered(void) const { return m_powered; }
+
+        /**
+         * @brief Address of the first byte that did not reach the device at the last cut.
+         */
+        MemoryAddress_t cut_address(void) const { return m_cut_address; }
+
+        /**
+         * @brief Returns the fault and traffic counters.
+         */
+        const Fault_Memory_Stats_t &stats(void) const { return m_stats; }
+
+        /**
+         * @brief Resets the fault and traffic counters.
+         */
+        void reset_stats(void);
+
+    private:
+        struct Fault_Undo_t
+        {
+            MemoryAddress_t start;
+            std::vector<uint8_t> data;
+        };
+
+        MemoryAddress_t cut(uint8_t* data_ptr, MemoryAddress_t start, MemoryAddress_t len, MemoryAddress_t keep);
+        void cut_commit(void);
+        void tear(MemoryAddress_t start, MemoryAddress_t end);
+        void power_off(MemoryAddress_t address);
+        void save_undo(MemoryAddress_t start, MemoryAddress_t len);
+        void roll_back(uint32_t first);
+        void split_undo(MemoryAddress_t start, MemoryAddress_t len, std::vector<Fault_Undo_t> &inside);
+        uint32_t random(void);
+
+    private:
+        Fault_Memory_Config_t *m_config;
+        Fault_Memory_Stats_t m_stats;
+        std::vector<Fault_Undo_t> m_undo;
+        std::vector<uint8_t> m_buffer;
+        uint32_t m_cut_writes;
+        uint32_t m_cut_bytes;
+        uint32_t m_cut_commits;
+        uint32_t m_flip_interval;
+        uint32_t m_flip_countdown;
+        uint32_t m_random;
+        MemoryAddress_t m_cut_address;
+        bool m_powered;
+    };
+
+#endif
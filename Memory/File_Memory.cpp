@@ -0,0 +1,103 @@
+/* 64 bit off_t for fseeko() on 32 bit hosts, must precede the first include */
+#if !defined(_FILE_OFFSET_BITS)
+#define _FILE_OFFSET_BITS 64
+#endif
+#include "File_Memory.h"
+
+#if !defined(ARDUINO)
+#include <string.h>
+#include <sys/types.h>
+#include "MemoryManager_Debug.h"
+
+File_Memory::File_Memory(File_Memory_Config_t &config) : Memory(),
+                                                         m_config(&config),
+                                                         m_file(NULL)
+{
+}
+
+File_Memory::~File_Memory()
+{
+    if (m_file != NULL)
+    {
+        fclose(m_file);
+    }
+}
+
+void File_Memory::init(void)
+{
+    uint8_t zero = 0;
+
+    if (m_file != NULL)
+    {
+        return;
+    }
+
+    m_file = fopen(m_config->path, "r+b");
+    if (m_file == NULL)
+    {
+        m_file = fopen(m_config->path, "w+b");
+    }
+
+    if (m_file == NULL)
+    {
+        DBIF_LOG_ERROR("Cannot open %s", m_config->path);
+        return;
+    }
+
+    /* Hosts without large file support cannot seek beyond 2 GiB */
+    if ((sizeof(off_t) < 8u) && (m_config->memory_size > 0x80000000u))
+    {
+        DBIF_LOG_ERROR("%s exceeds the file offsets of the host", m_config->path);
+        fclose(m_file);
+        m_file = NULL;
+        return;
+    }
+
+    /* Grow the file to the image size, missing bytes read as 0 */
+    fseeko(m_file, 0, SEEK_END);
+    if ((m_config->memory_size > 0) && ((uint64_t)ftello(m_file) < m_config->memory_size))
+    {
+        seek(m_config->memory_size - 1u);
+        fwrite(&zero, 1, 1, m_file);
+        fflush(m_file);
+    }
+}
+
+MemoryAddress_t File_Memory::read(uint8_t* data_ptr, MemoryAddress_t start, MemoryAddress_t len)
+{
+    MemoryAddress_t read_bytes = 0;
+
+    if (in_range(start, len) && seek(start))
+    {
+        read_bytes = fread(data_ptr, 1, len, m_file);
+    }
+    return read_bytes;
+}
+
+MemoryAddress_t File_Memory::write(uint8_t* data_ptr, MemoryAddress_t start, MemoryAddress_t len)
+{
+    MemoryAddress_t written_bytes = 0;
+
+    if (in_range(start, len) && seek(start))
+    {
+        written_bytes = fwrite(data_ptr, 1, len, m_file);
+    }
+    return written_bytes;
+}
+
+bool File_Memory::commit(void)
+{
+    return (m_file != NULL) && (fflush(m_file) == 0);
+}
+
+bool File_Memory::in_range(MemoryAddress_t start, MemoryAddress_t len)
+{
+    return (m_file != NULL) && ((uint64_t)start + len <= m_config->memory_size);
+}
+
+bool File_Memory::seek(MemoryAddress_t start)
+{
+    /* fseek() takes a long, which is 32 bit on many hosts and breaks at 2 GiB */
+    return fseeko(m_file, (off_t)start, SEEK_SET) == 0;
+}
+#endif
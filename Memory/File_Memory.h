@@ -0,0 +1,45 @@
+#ifndef FILE_MEMORY_H
+#define FILE_MEMORY_H
+
+#if !defined(ARDUINO)
+#include <stdio.h>
+#include "Memory.h"
+
+struct File_Memory_Config_t
+{
+    const char *path;               /**< Image file, created if it does not exist. */
+    MemoryAddress_t memory_size;    /**< Size of the image in bytes. */
+};
+
+/**
+ * @class File_Memory
+ * @brief Memory backed by an image file for Linux/host builds.
+ *
+ * Intended for simulation and for testing images which exceed the RAM of
+ * the target. Offsets use fseeko(), so images up to the 4 GiB of
+ * MemoryAddress_t work on 32 bit hosts as well. commit() flushes the
+ * written data to the file.
+ */
+class File_Memory : public Memory
+{
+
+    public:
+        File_Memory(File_Memory_Config_t &config);
+        ~File_Memory();
+        void init(void);
+        MemoryAddress_t read(uint8_t* data_ptr, MemoryAddress_t start, MemoryAddress_t len);
+        MemoryAddress_t write(uint8_t* data_ptr, MemoryAddress_t start, MemoryAddress_t len);
+        bool commit(void);
+
+    private:
+        bool in_range(MemoryAddress_t start, MemoryAddress_t len);
+        bool seek(MemoryAddress_t start);
+
+    private:
+        File_Memory_Config_t *m_config;
+        FILE *m_file;
+    };
+
+#endif
+
+#endif
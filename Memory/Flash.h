@@ -0,0 +1,70 @@
+#ifndef MEMORY_FLASH_IF_H
+#define MEMORY_FLASH_IF_H
+#include <stdint.h>
+
+/**
+ * @class Flash
+ * @brief Raw NOR flash interface used by log structured Memory backends.
+ *
+ * Programming can only clear bits, a sector has to be erased (all bytes 0xFF)
+ * before it can be programmed again.
+ */
+class Flash
+{
+public:
+    Flash() {};
+    virtual bool read(uint32_t address, uint8_t* data_ptr, uint32_t len) = 0;
+    virtual bool program(uint32_t address, const uint8_t* data_ptr, uint32_t len) = 0;
+    virtual bool erase_sector(uint16_t sector) = 0;
+    virtual uint32_t sector_size(void) = 0;
+    virtual uint16_t sector_count(void) = 0;
+};
+
+#if defined(ESP32)
+#include "esp_partition.h"
+
+/**
+ * @class Esp32_Flash
+ * @brief Flash implementation on top of an ESP32 data partition.
+ */
+class Esp32_Flash : public Flash
+{
+public:
+    Esp32_Flash(const char* partition_label) : Flash(), m_label(partition_label), m_partition(nullptr) {}
+
+    bool read(uint32_t address, uint8_t* data_ptr, uint32_t len)
+    {
+        return (partition() != nullptr) && (esp_partition_read(m_partition, address, data_ptr, len) == ESP_OK);
+    }
+
+    bool program(uint32_t address, const uint8_t* data_ptr, uint32_t len)
+    {
+        return (partition() != nullptr) && (esp_partition_write(m_partition, address, data_ptr, len) == ESP_OK);
+    }
+
+    bool erase_sector(uint16_t sector)
+    {
+        return (partition() != nullptr) &&
+               (esp_partition_erase_range(m_partition, sector * sector_size(), sector_size()) == ESP_OK);
+    }
+
+    uint32_t sector_size(void) { return SPI_FLASH_SEC_SIZE; }
+
+    uint16_t sector_count(void) { return (partition() != nullptr) ? (m_partition->size / SPI_FLASH_SEC_SIZE) : 0; }
+
+private:
+    const esp_partition_t* partition(void)
+    {
+        if (m_partition == nullptr)
+        {
+            m_partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, m_label);
+        }
+        return m_partition;
+    }
+
+    const char* m_label;
+    const esp_partition_t* m_partition;
+};
+#endif
+
+#endif
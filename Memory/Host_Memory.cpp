@@ -0,0 +1,160 @@
+#include "Host_Memory.h"
+
+#if !defined(ARDUINO)
+#include <chrono>
+#include <string.h>
+
+Host_Memory::Host_Memory(Host_Memory_Config_t &config) : Memory(),
+                                                         m_config(&config),
+                                                         m_outstanding(0),
+                                                         m_stop(false)
+{
+}
+
+Host_Memory::~Host_Memory()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_condition.notify_all();
+    if (m_worker.joinable())
+    {
+        m_worker.join();
+    }
+}
+
+void Host_Memory::init(void)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    if (m_image.size() != m_config->memory_size)
+    {
+        m_image.assign(m_config->memory_size, 0x00);
+    }
+    if (m_worker.joinable() == false)
+    {
+        m_worker = std::thread(&Host_Memory::worker, this);
+    }
+}
+
+MemoryAddress_t Host_Memory::read(uint8_t* data_ptr, MemoryAddress_t start, MemoryAddress_t len)
+{
+    Host_Request_t request = {HOST_READ, data_ptr, start, len, nullptr, nullptr, 0, false};
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    return execute(request) ? len : 0;
+}
+
+MemoryAddress_t Host_Memory::write(uint8_t* data_ptr, MemoryAddress_t start, MemoryAddress_t len)
+{
+    Host_Request_t request = {HOST_WRITE, data_ptr, start, len, nullptr, nullptr, 0, false};
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    return execute(request) ? len : 0;
+}
+
+bool Host_Memory::commit(void)
+{
+    return true;
+}
+
+bool Host_Memory::read_async(uint8_t* data_ptr, MemoryAddress_t start, MemoryAddress_t len, MemoryIoCallback_t callback, void *context, uint32_t tag)
+{
+    return enqueue(Host_Request_t{HOST_READ, data_ptr, start, len, callback, context, tag, false});
+}
+
+bool Host_Memory::write_async(uint8_t* data_ptr, MemoryAddress_t start, MemoryAddress_t len, MemoryIoCallback_t callback, void *context, uint32_t tag)
+{
+    return enqueue(Host_Request_t{HOST_WRITE, data_ptr, start, len, callback, context, tag, false});
+}
+
+bool Host_Memory::commit_async(MemoryIoCallback_t callback, void *context, uint32_t tag)
+{
+    return enqueue(Host_Request_t{HOST_COMMIT, nullptr, 0, 0, callback, context, tag, false});
+}
+
+void Host_Memory::poll(void)
+{
+    std::deque<Host_Request_t> completed;
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        completed.swap(m_completed);
+        m_outstanding -= completed.size();
+    }
+
+    /* Callbacks run in the caller's thread, without the lock held */
+    for (Host_Request_t &request : completed)
+    {
+        if (request.callback != nullptr)
+        {
+            request.callback(request.context, request.tag, request.success);
+        }
+    }
+}
+
+bool Host_Memory::busy(void)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_outstanding > 0;
+}
+
+bool Host_Memory::enqueue(const Host_Request_t &request)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_worker.joinable() == false)
+        {
+            return false;
+        }
+        m_requests.push_back(request);
+        m_outstanding++;
+    }
+    m_condition.notify_one();
+    return true;
+}
+
+bool Host_Memory::execute(Host_Request_t &request)
+{
+    request.success = (request.type == HOST_COMMIT) ||
+                      ((request.data_ptr != nullptr) && ((uint64_t)request.start + request.len <= m_image.size()));
+
+    if (request.success && (request.type == HOST_READ))
+    {
+        memcpy(request.data_ptr, &m_image[request.start], request.len);
+    }
+    else if (request.success && (request.type == HOST_WRITE))
+    {
+        memcpy(&m_image[request.start], request.data_ptr, request.len);
+    }
+    return request.success;
+}
+
+void Host_Memory::worker(void)
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+
+    while (m_stop == false)
+    {
+        m_condition.wait(lock, [this] { return m_stop || (m_requests.empty() == false); });
+        if (m_stop)
+        {
+            break;
+        }
+
+        Host_Request_t request = m_requests.front();
+        m_requests.pop_front();
+
+        /* Simulated bus transfer, the caller is free in the meantime */
+        lock.unlock();
+        std::this_thread::sleep_for(std::chrono::microseconds(m_config->latency_us) +
+                                    std::chrono::nanoseconds((uint64_t)m_config->byte_time_ns * request.len));
+        lock.lock();
+
+        execute(request);
+        m_completed.push_back(request);
+    }
+}
+
+#endif
@@ -0,0 +1,81 @@
+#ifndef HOST_MEMORY_H
+#define HOST_MEMORY_H
+
+#if !defined(ARDUINO)
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "Memory.h"
+
+struct Host_Memory_Config_t
+{
+    MemoryAddress_t memory_size; /**< Size of the simulated memory in bytes. */
+    uint32_t latency_us;        /**< Simulated latency of each request. */
+    uint32_t byte_time_ns;      /**< Simulated transfer time per byte. */
+};
+
+/**
+ * @class Host_Memory
+ * @brief RAM backed Memory for Linux/host builds which completes asynchronous
+ *        requests on a worker thread, standing in for DMA driven SPI/I2C devices.
+ *
+ * Synchronous calls bypass the request queue and must not be mixed with
+ * outstanding asynchronous requests.
+ */
+class Host_Memory : public Memory
+{
+
+    public:
+        Host_Memory(Host_Memory_Config_t &config);
+        ~Host_Memory();
+        void init(void);
+        MemoryAddress_t read(uint8_t* data_ptr, MemoryAddress_t start, MemoryAddress_t len);
+        MemoryAddress_t write(uint8_t* data_ptr, MemoryAddress_t start, MemoryAddress_t len);
+        bool commit(void);
+
+        bool read_async(uint8_t* data_ptr, MemoryAddress_t start, MemoryAddress_t len, MemoryIoCallback_t callback, void *context, uint32_t tag);
+        bool write_async(uint8_t* data_ptr, MemoryAddress_t start, MemoryAddress_t len, MemoryIoCallback_t callback, void *context, uint32_t tag);
+        bool commit_async(MemoryIoCallback_t callback, void *context, uint32_t tag);
+        void poll(void);
+        bool busy(void);
+
+    private:
+        enum Host_Request_e
+        {
+            HOST_READ,
+            HOST_WRITE,
+            HOST_COMMIT
+        };
+
+        struct Host_Request_t
+        {
+            Host_Request_e type;
+            uint8_t *data_ptr;
+            MemoryAddress_t start;
+            MemoryAddress_t len;
+            MemoryIoCallback_t callback;
+            void *context;
+            uint32_t tag;
+            bool success;
+        };
+
+        bool enqueue(const Host_Request_t &request);
+        bool execute(Host_Request_t &request);
+        void worker(void);
+
+    private:
+        Host_Memory_Config_t *m_config;
+        std::vector<uint8_t> m_image;
+        std::deque<Host_Request_t> m_requests;
+        std::deque<Host_Request_t> m_completed;
+        std::mutex m_mutex;
+        std::condition_variable m_condition;
+        std::thread m_worker;
+        uint32_t m_outstanding;
+        bool m_stop;
+    };
+
+#endif
+#endif
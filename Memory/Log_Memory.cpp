@@ -0,0 +1,339 @@
+#include <stddef.h>
+#include "Log_Memory.h"
+#include "../MemoryCrc/MemoryCrc.h"
+#include "MemoryManager_Debug.h"
+
+#define LOG_MEMORY_MAGIC        0x4C4F4732u /* "LOG2", 32 bit record offsets */
+#define LOG_MEMORY_ERASED_START 0xFFFFFFFFu
+
+Log_Memory::Log_Memory(Log_Memory_Config_t &config) : Memory(),
+                                                      m_config(&config),
+                                                      m_active_sector(0),
+                                                      m_generation(0),
+                                                      m_write_pos(0),
+                                                      m_sequence(0),
+                                                      m_spare_erased(false)
+{
+}
+
+void Log_Memory::init(void)
+{
+    uint32_t generation = 0;
+    bool found = false;
+
+    m_image.assign(m_config->memory_size, 0x00);
+    m_dirty.assign((m_config->memory_size / LOG_MEMORY_DIRTY_CHUNK / 8u) + 1u, 0x00);
+    m_sequence = 0;
+    m_spare_erased = false;
+
+    for (uint16_t sector = 0; sector < m_config->flash->sector_count(); sector++)
+    {
+        if (sector_header_valid(sector, generation) && ((found == false) || (generation > m_generation)))
+        {
+            m_active_sector = sector;
+            m_generation = generation;
+            found = true;
+        }
+    }
+
+    if (found)
+    {
+        DBIF_LOG_DEBUG_0("Log Sector %i, Generation %i", m_active_sector, m_generation);
+        replay_sector(m_active_sector);
+    }
+    else
+    {
+        DBIF_LOG_DEBUG_0("No valid Log Sector found, format Sector 0");
+        m_active_sector = 0;
+        m_generation = 1;
+        m_config->flash->erase_sector(m_active_sector);
+        write_sector_header(m_active_sector, m_generation);
+        m_write_pos = sizeof(Log_Sector_Header_t);
+    }
+}
+
+MemoryAddress_t Log_Memory::read(uint8_t* data_ptr, MemoryAddress_t start, MemoryAddress_t len)
+{
+    MemoryAddress_t read_bytes = 0;
+
+    if ((data_ptr != NULL) && ((uint64_t)start + len <= m_image.size()))
+    {
+        memcpy(data_ptr, &m_image[start], len);
+        read_bytes = len;
+    }
+    return read_bytes;
+}
+
+MemoryAddress_t Log_Memory::write(uint8_t* data_ptr, MemoryAddress_t start, MemoryAddress_t len)
+{
+    MemoryAddress_t written_bytes = 0;
+
+    if ((data_ptr != NULL) && ((uint64_t)start + len <= m_image.size()))
+    {
+        /* Only changed chunks end up in the log */
+        for (MemoryAddress_t i = 0; i < len; i++)
+        {
+            if (m_image[start + i] != data_ptr[i])
+            {
+                m_image[start + i] = data_ptr[i];
+                mark_dirty(start + i, 1);
+            }
+        }
+        written_bytes = len;
+    }
+    return written_bytes;
+}
+
+bool Log_Memory::commit(void)
+{
+    return commit_range(0, m_image.size());
+}
+
+bool Log_Memory::commit_range(MemoryAddress_t start, MemoryAddress_t len)
+{
+    bool ret = true;
+    uint64_t end = ((uint64_t)start + len < m_image.size()) ? ((uint64_t)start + len) : m_image.size();
+    uint32_t first_chunk = start / LOG_MEMORY_DIRTY_CHUNK;
+    uint32_t chunks = (end + LOG_MEMORY_DIRTY_CHUNK - 1u) / LOG_MEMORY_DIRTY_CHUNK;
+    MemoryAddress_t run_start;
+    uint16_t run_len;
+
+    for (uint32_t chunk = first_chunk; (chunk < chunks) && ret; chunk++)
+    {
+        if (is_dirty(chunk))
+        {
+            /* Merge consecutive dirty chunks into one record */
+            run_start = chunk * LOG_MEMORY_DIRTY_CHUNK;
+            run_len = 0;
+            while ((chunk < chunks) && is_dirty(chunk) && (run_len + LOG_MEMORY_DIRTY_CHUNK <= LOG_MEMORY_MAX_RECORD))
+            {
+                run_len += LOG_MEMORY_DIRTY_CHUNK;
+                chunk++;
+            }
+            chunk--;
+
+            if (run_start + run_len > m_image.size())
+            {
+                run_len = m_image.size() - run_start;
+            }
+
+            if (m_write_pos + record_size(run_len) > compaction_limit())
+            {
+                /* The compaction copies the complete image incl. all pending changes */
+                return compact();
+            }
+            ret = append(m_active_sector, m_write_pos, run_start, run_len);
+        }
+    }
+
+    if (ret)
+    {
+        clear_dirty(first_chunk, chunks);
+    }
+    else
+    {
+        DBIF_LOG_ERROR("Log append failed");
+    }
+    return ret;
+}
+
+bool Log_Memory::compact(void)
+{
+    bool ret = true;
+    uint16_t target = spare_sector();
+    uint32_t pos = sizeof(Log_Sector_Header_t);
+    uint16_t len;
+    bool live;
+
+    DBIF_LOG_DEBUG_0("Compact Log Sector %i -> %i", m_active_sector, target);
+
+    if (m_spare_erased == false)
+    {
+        ret = m_config->flash->erase_sector(target);
+    }
+
+    for (uint32_t start = 0; (start < m_image.size()) && ret; start += LOG_MEMORY_MAX_RECORD)
+    {
+        len = ((m_image.size() - start) < LOG_MEMORY_MAX_RECORD) ? (m_image.size() - start) : LOG_MEMORY_MAX_RECORD;
+
+        /* Ranges still in their initial state are restored by init() anyway */
+        live = false;
+        for (uint16_t i = 0; (i < len) && (live == false); i++)
+        {
+            live = (m_image[start + i] != 0x00);
+        }
+
+        if (live)
+        {
+            if (pos + record_size(len) > m_config->flash->sector_size())
+            {
+                DBIF_LOG_ERROR("Image does not fit into one Log Sector");
+                ret = false;
+            }
+            else
+            {
+                ret = append(target, pos, start, len);
+            }
+        }
+    }
+
+    /* The header is written last, an interrupted compaction leaves the old sector active */
+    if (ret)
+    {
+        ret = write_sector_header(target, m_generation + 1u);
+    }
+
+    m_spare_erased = false;
+    if (ret)
+    {
+        m_active_sector = target;
+        m_generation++;
+        m_write_pos = pos;
+        memset(m_dirty.data(), 0x00, m_dirty.size());
+    }
+    return ret;
+}
+
+void Log_Memory::idle(void)
+{
+    if (m_write_pos >= compaction_limit())
+    {
+        compact();
+    }
+    else if (m_spare_erased == false)
+    {
+        m_spare_erased = m_config->flash->erase_sector(spare_sector());
+    }
+}
+
+bool Log_Memory::replay_sector(uint16_t sector)
+{
+    Log_Record_Header_t record;
+    uint8_t payload[LOG_MEMORY_MAX_RECORD];
+    uint32_t sector_size = m_config->flash->sector_size();
+    uint32_t crc;
+    bool valid = true;
+
+    m_write_pos = sizeof(Log_Sector_Header_t);
+
+    while (m_write_pos + sizeof(Log_Record_Header_t) <= sector_size)
+    {
+        m_config->flash->read(sector * sector_size + m_write_pos, reinterpret_cast<uint8_t *>(&record), sizeof(record));
+
+        if ((record.start == LOG_MEMORY_ERASED_START) && (record.len == 0xFFFFu) && (record.seq == 0xFFFFFFFFu))
+        {
+            break; /* End of log */
+        }
+
+        valid = (record.len <= LOG_MEMORY_MAX_RECORD) &&
+                ((uint64_t)record.start + record.len <= m_image.size()) &&
+                (m_write_pos + record_size(record.len) <= sector_size);
+        if (valid)
+        {
+            m_config->flash->read(sector * sector_size + m_write_pos + sizeof(record), payload, record.len);
+            crc = MemoryCrc_crc32(reinterpret_cast<uint8_t *>(&record), offsetof(Log_Record_Header_t, crc));
+            crc = MemoryCrc_crc32(payload, record.len, crc);
+            valid = (crc == record.crc);
+        }
+
+        if (valid == false)
+        {
+            /* Torn append: nothing can be programmed behind it, force a compaction */
+            DBIF_LOG_ERROR("Invalid Log Record at %i", m_write_pos);
+            m_write_pos = sector_size;
+            break;
+        }
+
+        memcpy(&m_image[record.start], payload, record.len);
+        m_sequence = record.seq + 1u;
+        m_write_pos += record_size(record.len);
+    }
+    return valid;
+}
+
+bool Log_Memory::append(uint16_t sector, uint32_t &pos, MemoryAddress_t start, uint16_t len)
+{
+    Log_Record_Header_t record;
+    uint32_t address = sector * m_config->flash->sector_size() + pos;
+    bool ret;
+
+    record.start = start;
+    record.len = len;
+    record.reserved = 0;
+    record.seq = m_sequence;
+    record.crc = MemoryCrc_crc32(reinterpret_cast<uint8_t *>(&record), offsetof(Log_Record_Header_t, crc));
+    record.crc = MemoryCrc_crc32(&m_image[start], len, record.crc);
+
+    /* An interrupted program leaves a record with invalid crc, which is detected by init() */
+    ret = m_config->flash->program(address, reinterpret_cast<uint8_t *>(&record), sizeof(record)) &&
+          m_config->flash->program(address + sizeof(record), &m_image[start], len);
+    if (ret)
+    {
+        m_sequence++;
+        pos += record_size(len);
+    }
+    return ret;
+}
+
+bool Log_Memory::write_sector_header(uint16_t sector, uint32_t generation)
+{
+    Log_Sector_Header_t header;
+
+    header.magic = LOG_MEMORY_MAGIC;
+    header.generation = generation;
+    header.crc = MemoryCrc_crc32(reinterpret_cast<uint8_t *>(&header), offsetof(Log_Sector_Header_t, crc));
+
+    return m_config->flash->program(sector * m_config->flash->sector_size(),
+                                    reinterpret_cast<uint8_t *>(&header),
+                                    sizeof(header));
+}
+
+bool Log_Memory::sector_header_valid(uint16_t sector, uint32_t &generation)
+{
+    Log_Sector_Header_t header;
+    bool ret = false;
+
+    if (m_config->flash->read(sector * m_config->flash->sector_size(), reinterpret_cast<uint8_t *>(&header), sizeof(header)))
+    {
+        ret = (header.magic == LOG_MEMORY_MAGIC) &&
+              (header.crc == MemoryCrc_crc32(reinterpret_cast<uint8_t *>(&header), offsetof(Log_Sector_Header_t, crc)));
+        generation = header.generation;
+    }
+    return ret;
+}
+
+uint32_t Log_Memory::record_size(uint16_t len)
+{
+    return (sizeof(Log_Record_Header_t) + len + 3u) & ~3u;
+}
+
+uint32_t Log_Memory::compaction_limit(void)
+{
+    return (m_config->flash->sector_size() / 100u) * m_config->compaction_threshold;
+}
+
+uint16_t Log_Memory::spare_sector(void)
+{
+    return (m_active_sector + 1u) % m_config->flash->sector_count();
+}
+
+void Log_Memory::mark_dirty(MemoryAddress_t start, MemoryAddress_t len)
+{
+    for (uint32_t chunk = start / LOG_MEMORY_DIRTY_CHUNK; chunk <= (start + len - 1u) / LOG_MEMORY_DIRTY_CHUNK; chunk++)
+    {
+        m_dirty[chunk / 8u] |= (1u << (chunk % 8u));
+    }
+}
+
+void Log_Memory::clear_dirty(uint32_t first_chunk, uint32_t last_chunk)
+{
+    for (uint32_t chunk = first_chunk; chunk < last_chunk; chunk++)
+    {
+        m_dirty[chunk / 8u] &= ~(1u << (chunk % 8u));
+    }
+}
+
+bool Log_Memory::is_dirty(uint32_t chunk)
+{
+    return (m_dirty[chunk / 8u] & (1u << (chunk % 8u))) != 0;
+}
@@ -0,0 +1,116 @@
+#ifndef LOG_MEMORY_H
+#define LOG_MEMORY_H
+#include <vector>
+#include "Memory.h"
+#include "Flash.h"
+
+/**
+ * @def LOG_MEMORY_DIRTY_CHUNK
+ * @brief Granularity in bytes in which changes of the RAM image are tracked.
+ */
+#ifndef LOG_MEMORY_DIRTY_CHUNK
+#define LOG_MEMORY_DIRTY_CHUNK 16u
+#endif
+
+/**
+ * @def LOG_MEMORY_MAX_RECORD
+ * @brief Maximum payload length of a single log record.
+ */
+#ifndef LOG_MEMORY_MAX_RECORD
+#define LOG_MEMORY_MAX_RECORD 256u
+#endif
+
+struct Log_Memory_Config_t
+{
+    Flash *flash;                   /**< Raw flash the log is stored in (at least two sectors). */
+    MemoryAddress_t memory_size;    /**< Size of the image presented to the MemoryManager. */
+    uint8_t compaction_threshold;   /**< Fill level of the active sector in percent which triggers a compaction. */
+};
+
+/**
+ * @class Log_Memory
+ * @brief Append only Memory backend for NOR flash.
+ *
+ * Writes go into a RAM image and are marked dirty. commit() appends one
+ * (block id, seq, len, crc, payload) record per dirty range to the active
+ * sector instead of rewriting the whole sector. init() rebuilds the image
+ * by replaying the records of the newest valid sector. Once the fill
+ * threshold is reached the live image is copied into a fresh sector.
+ */
+class Log_Memory : public Memory
+{
+
+    public:
+        Log_Memory(Log_Memory_Config_t &config);
+        void init(void);
+        MemoryAddress_t read(uint8_t* data_ptr, MemoryAddress_t start, MemoryAddress_t len);
+        MemoryAddress_t write(uint8_t* data_ptr, MemoryAddress_t start, MemoryAddress_t len);
+        bool commit(void);
+
+        /**
+         * @brief Appends the dirty chunks within the range only, other changes stay pending.
+         *
+         * A compaction triggered by the commit copies the complete image,
+         * including pending changes outside of the range.
+         */
+        bool commit_range(MemoryAddress_t start, MemoryAddress_t len);
+
+        /**
+         * @brief Copies all live data into the spare sector and makes it the active one.
+         * @return True if the compaction was successful.
+         */
+        bool compact(void);
+
+        /**
+         * @brief Background work, to be called when the application is idle.
+         *
+         * Erases the spare sector ahead of time and compacts the log once the
+         * fill threshold is reached, so commit() does not have to.
+         */
+        void idle(void);
+
+        /**
+         * @brief Returns the number of used bytes in the active sector.
+         */
+        uint32_t fill_level(void) { return m_write_pos; }
+
+    private:
+        struct Log_Sector_Header_t
+        {
+            uint32_t magic;
+            uint32_t generation;
+            uint32_t crc;
+        };
+
+        struct Log_Record_Header_t
+        {
+            uint32_t start;     /**< Start offset of the record in the image. */
+            uint16_t len;
+            uint16_t reserved;
+            uint32_t seq;
+            uint32_t crc;
+        };
+
+        bool replay_sector(uint16_t sector);
+        bool append(uint16_t sector, uint32_t &pos, MemoryAddress_t start, uint16_t len);
+        bool write_sector_header(uint16_t sector, uint32_t generation);
+        bool sector_header_valid(uint16_t sector, uint32_t &generation);
+        uint32_t record_size(uint16_t len);
+        uint32_t compaction_limit(void);
+        uint16_t spare_sector(void);
+        void mark_dirty(MemoryAddress_t start, MemoryAddress_t len);
+        void clear_dirty(uint32_t first_chunk, uint32_t last_chunk);
+        bool is_dirty(uint32_t chunk);
+
+    private:
+        Log_Memory_Config_t *m_config;
+        std::vector<uint8_t> m_image;
+        std::vector<uint8_t> m_dirty;
+        uint16_t m_active_sector;
+        uint32_t m_generation;
+        uint32_t m_write_pos;
+        uint32_t m_sequence;
+        bool m_spare_erased;
+    };
+
+#endif
@@ -2,15 +2,106 @@
 #define MEMROY_MANAGER_IF_H
 #include "../MemoryManager_Types.h"
 
+/**
+ * @brief Completion callback of an asynchronous Memory request.
+ * @param context Context pointer passed with the request.
+ * @param tag Value passed with the request to identify it.
+ * @param success True if the request completed successfully.
+ */
+typedef void (*MemoryIoCallback_t)(void *context, uint32_t tag, bool success);
+
 class Memory
 {
 public:
     Memory() {};
     virtual void init() = 0;
-    virtual uint16_t read(uint8_t* data_ptr, uint16_t start, uint16_t len) = 0;
-    virtual uint16_t write(uint8_t* data_ptr, uint16_t start, uint16_t len) = 0;
-    virtual bool commit(void) {return true;} 
+    virtual MemoryAddress_t read(uint8_t* data_ptr, MemoryAddress_t start, MemoryAddress_t len) = 0;
+    virtual MemoryAddress_t write(uint8_t* data_ptr, MemoryAddress_t start, MemoryAddress_t len) = 0;
+    virtual bool commit(void) {return true;}
+
+    /**
+     * @brief Commits the data written to the given range.
+     *
+     * Backends which can only commit as a whole (e.g. an emulated EEPROM
+     * sector) commit everything, which is the default implementation.
+     *
+     * @param start Start of the range.
+     * @param len Length of the range.
+     * @return True if the commit was successful.
+     */
+    virtual bool commit_range(MemoryAddress_t start, MemoryAddress_t len)
+    {
+        (void)start;
+        (void)len;
+        return commit();
+    }
+
+    /**
+     * @brief Asynchronous variants of read(), write() and commit().
+     *
+     * Requests are executed in the order they were issued. The buffer has to
+     * stay valid until the request completed. The callback is invoked from
+     * poll() (or directly, by backends without asynchronous transfers), never
+     * from an interrupt or another thread. The default implementations run
+     * the synchronous call and complete immediately.
+     *
+     * @return False if the request could not be issued, the callback is not invoked then.
+     */
+    virtual bool read_async(uint8_t* data_ptr, MemoryAddress_t start, MemoryAddress_t len, MemoryIoCallback_t callback, void *context, uint32_t tag)
+    {
+        bool success = (read(data_ptr, start, len) > 0);
+        if (callback != nullptr)
+        {
+            callback(context, tag, success);
+        }
+        return true;
+    }
+
+    virtual bool write_async(uint8_t* data_ptr, MemoryAddress_t start, MemoryAddress_t len, MemoryIoCallback_t callback, void *context, uint32_t tag)
+    {
+        bool success = (write(data_ptr, start, len) > 0);
+        if (callback != nullptr)
+        {
+            callback(context, tag, success);
+        }
+        return true;
+    }
+
+    virtual bool commit_async(MemoryIoCallback_t callback, void *context, uint32_t tag)
+    {
+        bool success = commit();
+        if (callback != nullptr)
+        {
+            callback(context, tag, success);
+        }
+        return true;
+    }
+
+    /**
+     * @brief Placement hint for the range of a block, used by backends with several tiers.
+     * @param start Start of the block (data and parameters).
+     * @param len Length of the block.
+     * @param temperature Current write frequency class of the block.
+     * @return False if the placement can not be queued, the block stays in its tier.
+     */
+    virtual bool place(MemoryAddress_t start, MemoryAddress_t len, MemoryBlockTemperature_e temperature)
+    {
+        (void)start;
+        (void)len;
+        (void)temperature;
+        return true;
+    }
+
+    /**
+     * @brief Invokes the callbacks of completed asynchronous requests.
+     */
+    virtual void poll(void) {}
+
+    /**
+     * @brief Returns true while asynchronous requests are outstanding.
+     */
+    virtual bool busy(void) { return false; }
 
 };
 
-#endif
\ No newline at end of file
+#endif
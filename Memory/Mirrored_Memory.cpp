@@ -0,0 +1,560 @@
+#include <stddef.h>
+#include <string.h>
+#include "Mirrored_Memory.h"
+#include "../MemoryCrc/MemoryCrc.h"
+#include "../MemoryTimer/MemoryTimer.h"
+#include "MemoryManager_Debug.h"
+
+#define MIRRORED_MEMORY_MAGIC           0x4D495252u /* "MIRR" */
+#define MIRRORED_MEMORY_TABLE_WORDS     3u          /* magic, generation, table crc */
+#define MIRRORED_MEMORY_SYNC_WRITE      0x100u      /* Tag of the device writes of write() */
+
+enum Mirrored_Commit_Stage_e
+{
+    COMMIT_IDLE = 0,
+    COMMIT_SOURCE,
+    COMMIT_COPY
+};
+
+Mirrored_Memory::Mirrored_Memory(Mirrored_Memory_Config_t &config) : Memory(),
+                                                                     m_config(&config),
+                                                                     m_read_first(0),
+                                                                     m_scrub_page(0),
+                                                                     m_commit_stage(COMMIT_IDLE),
+                                                                     m_commit_source(0),
+                                                                     m_commit_generation(0),
+                                                                     m_commit_success(true),
+                                                                     m_commit_callback(nullptr),
+                                                                     m_commit_context(nullptr),
+                                                                     m_commit_tag(0),
+                                                                     m_sync_pending(0)
+{
+    m_generation[0] = 0;
+    m_generation[1] = 0;
+    m_write_failed[0] = false;
+    m_write_failed[1] = false;
+}
+
+void Mirrored_Memory::init(void)
+{
+    uint8_t buffer[MIRRORED_MEMORY_PAGE_SIZE];
+    uint32_t duration[2];
+    bool valid[2];
+    uint8_t newer;
+    uint8_t older;
+
+    m_dirty.assign((page_count() / 8u) + 1u, 0x00);
+    m_scrub_page = 0;
+
+    for (uint8_t device = 0; device < 2u; device++)
+    {
+        m_config->memory[device]->init();
+        m_repair[device].assign((page_count() / 8u) + 1u, 0x00);
+        m_write_failed[device] = false;
+
+        /* The table read doubles as the speed probe of the device */
+        duration[device] = MemoryTimer::now_us();
+        valid[device] = load_table(device);
+        duration[device] = MemoryTimer::now_us() - duration[device];
+    }
+
+    m_read_first = (duration[1] < duration[0]) ? 1u : 0u;
+
+    if (valid[0] && valid[1])
+    {
+        if (m_generation[0] != m_generation[1])
+        {
+            /* Interrupted commit: read the newer copy and bring the other one up to date */
+            newer = (m_generation[1] > m_generation[0]) ? 1u : 0u;
+            older = 1u - newer;
+            DBIF_LOG_DEBUG_0("Mirror Generations differ, reading from Device %i", newer);
+            m_read_first = newer;
+            for (uint32_t page = 0; page < page_count(); page++)
+            {
+                if (m_crc[older][page] != m_crc[newer][page])
+                {
+                    set_mark(m_repair[older], page, true);
+                }
+            }
+        }
+    }
+    else if (valid[0] || valid[1])
+    {
+        newer = valid[1] ? 1u : 0u;
+        older = 1u - newer;
+        DBIF_LOG_DEBUG_0("No valid Mirror Table on Device %i, repair all Pages", older);
+        m_read_first = newer;
+        m_crc[older] = m_crc[newer];
+        m_generation[older] = 0;
+        for (uint32_t page = 0; page < page_count(); page++)
+        {
+            set_mark(m_repair[older], page, true);
+        }
+    }
+    else
+    {
+        /* Fresh devices: the faster one defines the image, scrubbing aligns the other */
+        DBIF_LOG_DEBUG_0("No valid Mirror Table, format");
+        m_crc[m_read_first].assign(page_count(), 0);
+        for (uint32_t page = 0; page < page_count(); page++)
+        {
+            m_config->memory[m_read_first]->read(buffer, page * MIRRORED_MEMORY_PAGE_SIZE, page_length(page));
+            m_crc[m_read_first][page] = MemoryCrc_crc32(buffer, page_length(page));
+        }
+        m_crc[1u - m_read_first] = m_crc[m_read_first];
+        for (uint8_t device = 0; device < 2u; device++)
+        {
+            m_generation[device] = 1;
+            save_table(device);
+            m_config->memory[device]->commit();
+        }
+
+        /* The other device got the table but not the data, its pages are copied by idle() */
+        for (uint32_t page = 0; page < page_count(); page++)
+        {
+            set_mark(m_repair[1u - m_read_first], page, true);
+        }
+    }
+    DBIF_LOG_DEBUG_0("Mirror reads from Device %i, %i Pages to repair", m_read_first, pending_repairs());
+}
+
+MemoryAddress_t Mirrored_Memory::read(uint8_t* data_ptr, MemoryAddress_t start, MemoryAddress_t len)
+{
+    uint8_t buffer[MIRRORED_MEMORY_PAGE_SIZE];
+    uint8_t second = 1u - m_read_first;
+    MemoryAddress_t page_start;
+    MemoryAddress_t from;
+    MemoryAddress_t to;
+
+    if ((data_ptr == NULL) || (len == 0) || ((uint64_t)start + len > m_config->memory_size))
+    {
+        return 0;
+    }
+
+    for (uint32_t page = start / MIRRORED_MEMORY_PAGE_SIZE; page <= (start + len - 1u) / MIRRORED_MEMORY_PAGE_SIZE; page++)
+    {
+        page_start = page * MIRRORED_MEMORY_PAGE_SIZE;
+        from = (start > page_start) ? start : page_start;
+        to = ((start + len) < (page_start + page_length(page))) ? (start + len) : (page_start + page_length(page));
+
+        if (is_marked(m_dirty, page))
+        {
+            /* Written since the last commit, the table does not cover it yet */
+            if (m_config->memory[m_read_first]->read(data_ptr + (from - start), from, to - from) != (to - from))
+            {
+                return 0;
+            }
+            continue;
+        }
+
+        if (read_page(m_read_first, page, buffer) == false)
+        {
+            set_mark(m_repair[m_read_first], page, true);
+            if (read_page(second, page, buffer) == false)
+            {
+                /* Both copies are bad, hand out the preferred one and let the caller's checks decide */
+                DBIF_LOG_ERROR("Mirror Page %i invalid on both Devices", page);
+                set_mark(m_repair[m_read_first], page, false);
+                m_config->memory[m_read_first]->read(buffer, page_start, page_length(page));
+            }
+        }
+        memcpy(data_ptr + (from - start), &buffer[from - page_start], to - from);
+    }
+    return len;
+}
+
+MemoryAddress_t Mirrored_Memory::write(uint8_t* data_ptr, MemoryAddress_t start, MemoryAddress_t len)
+{
+    bool written = false;
+
+    if ((data_ptr == NULL) || (len == 0) || ((uint64_t)start + len > m_config->memory_size))
+    {
+        return 0;
+    }
+
+    mark(m_dirty, start, len);
+
+    /* Both devices transfer in parallel, devices without asynchronous transfers complete within write_async() */
+    m_sync_failed[0] = false;
+    m_sync_failed[1] = false;
+    m_sync_pending = 2;
+    for (uint8_t device = 0; device < 2u; device++)
+    {
+        if (m_config->memory[device]->write_async(data_ptr, start, len, &Mirrored_Memory::write_complete, this, MIRRORED_MEMORY_SYNC_WRITE | device) == false)
+        {
+            m_sync_failed[device] = true;
+            m_sync_pending--;
+        }
+    }
+    while (m_sync_pending > 0)
+    {
+        poll();
+        if (m_sync_pending > 0)
+        {
+            MemoryTimer::relax();
+        }
+    }
+
+    for (uint8_t device = 0; device < 2u; device++)
+    {
+        if (m_sync_failed[device])
+        {
+            DBIF_LOG_ERROR("Mirror Write failed on Device %i", device);
+            m_write_failed[device] = true;
+        }
+        written = written || (m_sync_failed[device] == false);
+    }
+    /* One good copy is enough, the other one is repaired after the commit */
+    return written ? len : 0;
+}
+
+bool Mirrored_Memory::commit(void)
+{
+    bool ret = true;
+
+    if (m_commit_stage != COMMIT_IDLE)
+    {
+        return false;
+    }
+
+    /* One device after the other, so a power loss leaves one consistent copy */
+    begin_commit();
+    for (uint8_t device = m_commit_source, i = 0; i < 2u; device = 1u - device, i++)
+    {
+        if ((m_config->memory[device]->commit() && finish_device(device)) == false)
+        {
+            m_write_failed[device] = true;
+            ret = false;
+        }
+    }
+    end_commit();
+    return ret;
+}
+
+bool Mirrored_Memory::write_async(uint8_t* data_ptr, MemoryAddress_t start, MemoryAddress_t len, MemoryIoCallback_t callback, void *context, uint32_t tag)
+{
+    uint8_t second = 1u - m_read_first;
+
+    if ((data_ptr == NULL) || (len == 0) || ((uint64_t)start + len > m_config->memory_size))
+    {
+        return false;
+    }
+
+    /*
+     * Both devices transfer in parallel, the request completes with the
+     * preferred one. A failed or overtaken write to the other device shows
+     * up as CRC mismatch and is repaired from the preferred copy.
+     */
+    mark(m_dirty, start, len);
+    if (m_config->memory[second]->write_async(data_ptr, start, len, &Mirrored_Memory::write_complete, this, second) == false)
+    {
+        m_write_failed[second] = true;
+    }
+    return m_config->memory[m_read_first]->write_async(data_ptr, start, len, callback, context, tag);
+}
+
+bool Mirrored_Memory::commit_async(MemoryIoCallback_t callback, void *context, uint32_t tag)
+{
+    if (m_commit_stage != COMMIT_IDLE)
+    {
+        return false;
+    }
+
+    m_commit_callback = callback;
+    m_commit_context = context;
+    m_commit_tag = tag;
+    m_commit_success = true;
+    begin_commit();
+
+    m_commit_stage = COMMIT_SOURCE;
+    if (m_config->memory[m_commit_source]->commit_async(&Mirrored_Memory::commit_complete, this, m_commit_source) == false)
+    {
+        commit_complete(this, m_commit_source, false);
+    }
+    return true;
+}
+
+void Mirrored_Memory::poll(void)
+{
+    m_config->memory[0]->poll();
+    m_config->memory[1]->poll();
+}
+
+bool Mirrored_Memory::busy(void)
+{
+    return (m_commit_stage != COMMIT_IDLE) || m_config->memory[0]->busy() || m_config->memory[1]->busy();
+}
+
+void Mirrored_Memory::idle(void)
+{
+    uint8_t buffer[MIRRORED_MEMORY_PAGE_SIZE];
+
+    if (busy() || (page_count() == 0))
+    {
+        return;
+    }
+
+    for (uint8_t device = 0; device < 2u; device++)
+    {
+        for (uint32_t page = 0; page < page_count(); page++)
+        {
+            if (is_marked(m_repair[device], page) && (is_marked(m_dirty, page) == false))
+            {
+                repair(device, page);
+                return;
+            }
+        }
+    }
+
+    /* Scrubbing finds pages which went bad since they were read last */
+    if (is_marked(m_dirty, m_scrub_page) == false)
+    {
+        for (uint8_t device = 0; device < 2u; device++)
+        {
+            if (read_page(device, m_scrub_page, buffer) == false)
+            {
+                DBIF_LOG_DEBUG_0("Mirror Page %i invalid on Device %i", m_scrub_page, device);
+                set_mark(m_repair[device], m_scrub_page, true);
+            }
+        }
+    }
+    m_scrub_page = (m_scrub_page + 1u) % page_count();
+}
+
+uint32_t Mirrored_Memory::pending_repairs(void)
+{
+    uint32_t count = 0;
+
+    for (uint8_t device = 0; device < 2u; device++)
+    {
+        for (uint32_t page = 0; page < page_count(); page++)
+        {
+            count += is_marked(m_repair[device], page) ? 1u : 0u;
+        }
+    }
+    return count;
+}
+
+MemoryAddress_t Mirrored_Memory::table_size(void)
+{
+    return (page_count() + MIRRORED_MEMORY_TABLE_WORDS) * sizeof(uint32_t);
+}
+
+bool Mirrored_Memory::load_table(uint8_t device)
+{
+    Memory *memory = m_config->memory[device];
+    MemoryAddress_t crc_len = page_count() * sizeof(uint32_t);
+    uint32_t head[2];
+    uint32_t crc;
+    bool ret;
+
+    /* Read in place, magic and generation, the page CRCs and the CRC over both */
+    m_crc[device].resize(page_count());
+    ret = (memory->read(reinterpret_cast<uint8_t *>(head), m_config->memory_size, sizeof(head)) == sizeof(head)) &&
+          (memory->read(reinterpret_cast<uint8_t *>(m_crc[device].data()), m_config->memory_size + sizeof(head), crc_len) == crc_len) &&
+          (memory->read(reinterpret_cast<uint8_t *>(&crc), m_config->memory_size + sizeof(head) + crc_len, sizeof(crc)) == sizeof(crc)) &&
+          (head[0] == MIRRORED_MEMORY_MAGIC) &&
+          (crc == MemoryCrc_crc32(reinterpret_cast<uint8_t *>(m_crc[device].data()), crc_len,
+                                  MemoryCrc_crc32(reinterpret_cast<uint8_t *>(head), sizeof(head))));
+
+    if (ret)
+    {
+        m_generation[device] = head[1];
+    }
+    else
+    {
+        m_generation[device] = 0;
+        memset(m_crc[device].data(), 0x00, crc_len);
+    }
+    return ret;
+}
+
+bool Mirrored_Memory::save_table(uint8_t device)
+{
+    Memory *memory = m_config->memory[device];
+    MemoryAddress_t crc_len = page_count() * sizeof(uint32_t);
+    uint32_t head[2] = {MIRRORED_MEMORY_MAGIC, m_generation[device]};
+    uint32_t crc;
+
+    /* Written from the CRC list in place, same layout as one table */
+    crc = MemoryCrc_crc32(reinterpret_cast<uint8_t *>(m_crc[device].data()), crc_len,
+                          MemoryCrc_crc32(reinterpret_cast<uint8_t *>(head), sizeof(head)));
+
+    return (memory->write(reinterpret_cast<uint8_t *>(head), m_config->memory_size, sizeof(head)) == sizeof(head)) &&
+           (memory->write(reinterpret_cast<uint8_t *>(m_crc[device].data()), m_config->memory_size + sizeof(head), crc_len) == crc_len) &&
+           (memory->write(reinterpret_cast<uint8_t *>(&crc), m_config->memory_size + sizeof(head) + crc_len, sizeof(crc)) == sizeof(crc));
+}
+
+void Mirrored_Memory::begin_commit(void)
+{
+    /* The table is computed from a device which received all writes */
+    m_commit_source = (m_write_failed[m_read_first] && (m_write_failed[1u - m_read_first] == false)) ? (1u - m_read_first) : m_read_first;
+    m_commit_generation = ((m_generation[0] > m_generation[1]) ? m_generation[0] : m_generation[1]) + 1u;
+}
+
+bool Mirrored_Memory::finish_device(uint8_t device)
+{
+    uint8_t buffer[MIRRORED_MEMORY_PAGE_SIZE];
+    bool dirty = false;
+
+    for (uint32_t page = 0; page < page_count(); page++)
+    {
+        if (is_marked(m_dirty, page))
+        {
+            dirty = true;
+            if (device == m_commit_source)
+            {
+                /* Read back, the crc covers what actually reached the device */
+                m_config->memory[device]->read(buffer, page * MIRRORED_MEMORY_PAGE_SIZE, page_length(page));
+                m_crc[device][page] = MemoryCrc_crc32(buffer, page_length(page));
+            }
+            else
+            {
+                m_crc[device][page] = m_crc[m_commit_source][page];
+            }
+        }
+    }
+
+    if (dirty == false)
+    {
+        return true;
+    }
+
+    /* The table goes in after the data, an interrupted commit leaves the old table */
+    m_generation[device] = m_commit_generation;
+    return save_table(device) && m_config->memory[device]->commit();
+}
+
+void Mirrored_Memory::end_commit(void)
+{
+    for (uint8_t device = 0; device < 2u; device++)
+    {
+        if (m_write_failed[device])
+        {
+            for (uint32_t page = 0; page < page_count(); page++)
+            {
+                if (is_marked(m_dirty, page))
+                {
+                    set_mark(m_repair[device], page, true);
+                }
+            }
+            m_write_failed[device] = false;
+        }
+    }
+    memset(m_dirty.data(), 0x00, m_dirty.size());
+}
+
+bool Mirrored_Memory::read_page(uint8_t device, uint32_t page, uint8_t *buffer)
+{
+    return (m_config->memory[device]->read(buffer, page * MIRRORED_MEMORY_PAGE_SIZE, page_length(page)) == page_length(page)) &&
+           (MemoryCrc_crc32(buffer, page_length(page)) == m_crc[device][page]);
+}
+
+bool Mirrored_Memory::repair(uint8_t device, uint32_t page)
+{
+    uint8_t buffer[MIRRORED_MEMORY_PAGE_SIZE];
+    uint8_t source = 1u - device;
+    bool ret;
+
+    set_mark(m_repair[device], page, false);
+    if (read_page(source, page, buffer) == false)
+    {
+        DBIF_LOG_ERROR("Mirror Page %i can not be repaired", page);
+        return false;
+    }
+
+    m_crc[device][page] = m_crc[source][page];
+    ret = (m_config->memory[device]->write(buffer, page * MIRRORED_MEMORY_PAGE_SIZE, page_length(page)) == page_length(page)) &&
+          save_table(device) &&
+          m_config->memory[device]->commit();
+    if (ret == false)
+    {
+        DBIF_LOG_ERROR("Mirror Repair of Page %i on Device %i failed", page, device);
+        set_mark(m_repair[device], page, true);
+    }
+    return ret;
+}
+
+uint32_t Mirrored_Memory::page_count(void)
+{
+    return (m_config->memory_size + MIRRORED_MEMORY_PAGE_SIZE - 1u) / MIRRORED_MEMORY_PAGE_SIZE;
+}
+
+MemoryAddress_t Mirrored_Memory::page_length(uint32_t page)
+{
+    MemoryAddress_t start = page * MIRRORED_MEMORY_PAGE_SIZE;
+
+    return ((m_config->memory_size - start) < MIRRORED_MEMORY_PAGE_SIZE) ? (m_config->memory_size - start) : MIRRORED_MEMORY_PAGE_SIZE;
+}
+
+void Mirrored_Memory::mark(std::vector<uint8_t> &bitmap, MemoryAddress_t start, MemoryAddress_t len)
+{
+    for (uint32_t page = start / MIRRORED_MEMORY_PAGE_SIZE; page <= (start + len - 1u) / MIRRORED_MEMORY_PAGE_SIZE; page++)
+    {
+        set_mark(bitmap, page, true);
+    }
+}
+
+bool Mirrored_Memory::is_marked(std::vector<uint8_t> &bitmap, uint32_t page)
+{
+    return (bitmap[page / 8u] & (1u << (page % 8u))) != 0;
+}
+
+void Mirrored_Memory::set_mark(std::vector<uint8_t> &bitmap, uint32_t page, bool value)
+{
+    if (value)
+    {
+        bitmap[page / 8u] |= (1u << (page % 8u));
+    }
+    else
+    {
+        bitmap[page / 8u] &= ~(1u << (page % 8u));
+    }
+}
+
+void Mirrored_Memory::write_complete(void *context, uint32_t tag, bool success)
+{
+    Mirrored_Memory *memory = static_cast<Mirrored_Memory *>(context);
+    uint8_t device = tag & 0x01u;
+
+    if ((tag & MIRRORED_MEMORY_SYNC_WRITE) != 0)
+    {
+        memory->m_sync_failed[device] = (success == false);
+        memory->m_sync_pending--;
+    }
+    else if (success == false)
+    {
+        memory->m_write_failed[device] = true;
+    }
+}
+
+void Mirrored_Memory::commit_complete(void *context, uint32_t tag, bool success)
+{
+    Mirrored_Memory *memory = static_cast<Mirrored_Memory *>(context);
+    uint8_t copy = 1u - memory->m_commit_source;
+
+    /* Queues of the device are drained here, the table is written synchronously */
+    if ((success && memory->finish_device(tag)) == false)
+    {
+        memory->m_write_failed[tag] = true;
+        memory->m_commit_success = false;
+    }
+
+    if (memory->m_commit_stage == COMMIT_SOURCE)
+    {
+        memory->m_commit_stage = COMMIT_COPY;
+        if (memory->m_config->memory[copy]->commit_async(&Mirrored_Memory::commit_complete, memory, copy) == false)
+        {
+            commit_complete(memory, copy, false);
+        }
+    }
+    else
+    {
+        memory->end_commit();
+        memory->m_commit_stage = COMMIT_IDLE;
+        if (memory->m_commit_callback != nullptr)
+        {
+            memory->m_commit_callback(memory->m_commit_context, memory->m_commit_tag, memory->m_commit_success);
+        }
+    }
+}
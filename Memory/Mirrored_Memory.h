@@ -0,0 +1,107 @@
+#ifndef MIRRORED_MEMORY_H
+#define MIRRORED_MEMORY_H
+#include <vector>
+#include "Memory.h"
+
+/**
+ * @def MIRRORED_MEMORY_PAGE_SIZE
+ * @brief Granularity in bytes of the CRC verification and the repair.
+ */
+#ifndef MIRRORED_MEMORY_PAGE_SIZE
+#define MIRRORED_MEMORY_PAGE_SIZE 256u
+#endif
+
+struct Mirrored_Memory_Config_t
+{
+    Memory *memory[2];              /**< The two devices holding a copy of the image. */
+    MemoryAddress_t memory_size;    /**< Size of the image, each device needs table_size() bytes more. */
+};
+
+/**
+ * @class Mirrored_Memory
+ * @brief Memory keeping a verified copy of the image on two devices.
+ *
+ * Each device stores the image followed by a table with one CRC32 per page
+ * and a generation counter. Writes go to both devices, write() issues them
+ * with write_async() so both transfer in parallel. commit() commits the
+ * devices one after the other, data before table, so a power loss leaves
+ * at least one consistent copy. Reads use the device with the faster table
+ * read during init() (after an interrupted commit the newer one) and fall
+ * back to the other device for pages failing the CRC check. Bad pages are
+ * repaired by idle(), which also scrubs one page per call.
+ */
+class Mirrored_Memory : public Memory
+{
+
+    public:
+        Mirrored_Memory(Mirrored_Memory_Config_t &config);
+        void init(void);
+        MemoryAddress_t read(uint8_t* data_ptr, MemoryAddress_t start, MemoryAddress_t len);
+        MemoryAddress_t write(uint8_t* data_ptr, MemoryAddress_t start, MemoryAddress_t len);
+        bool commit(void);
+
+        bool write_async(uint8_t* data_ptr, MemoryAddress_t start, MemoryAddress_t len, MemoryIoCallback_t callback, void *context, uint32_t tag);
+        bool commit_async(MemoryIoCallback_t callback, void *context, uint32_t tag);
+        void poll(void);
+        bool busy(void);
+
+        /**
+         * @brief Background work, to be called when the application is idle.
+         *
+         * Repairs one bad page or, if there is none, verifies the next page
+         * of both devices.
+         */
+        void idle(void);
+
+        /**
+         * @brief Returns the number of pages waiting for a repair.
+         */
+        uint32_t pending_repairs(void);
+
+        /**
+         * @brief Returns the device index reads are served from first.
+         */
+        uint8_t read_device(void) { return m_read_first; }
+
+        /**
+         * @brief Returns the number of bytes each device needs behind the image for the CRC table.
+         */
+        MemoryAddress_t table_size(void);
+
+    private:
+        bool load_table(uint8_t device);
+        bool save_table(uint8_t device);
+        void begin_commit(void);
+        bool finish_device(uint8_t device);
+        void end_commit(void);
+        bool read_page(uint8_t device, uint32_t page, uint8_t *buffer);
+        bool repair(uint8_t device, uint32_t page);
+        uint32_t page_count(void);
+        MemoryAddress_t page_length(uint32_t page);
+        void mark(std::vector<uint8_t> &bitmap, MemoryAddress_t start, MemoryAddress_t len);
+        bool is_marked(std::vector<uint8_t> &bitmap, uint32_t page);
+        void set_mark(std::vector<uint8_t> &bitmap, uint32_t page, bool value);
+        static void write_complete(void *context, uint32_t tag, bool success);
+        static void commit_complete(void *context, uint32_t tag, bool success);
+
+    private:
+        Mirrored_Memory_Config_t *m_config;
+        std::vector<uint32_t> m_crc[2];         /**< Page CRCs of the copy on each device. */
+        uint32_t m_generation[2];               /**< Number of commits of each device. */
+        std::vector<uint8_t> m_dirty;           /**< Pages written since the last commit. */
+        std::vector<uint8_t> m_repair[2];       /**< Pages to repair on each device. */
+        bool m_write_failed[2];                 /**< A write to the device failed since the last commit. */
+        uint8_t m_read_first;
+        uint32_t m_scrub_page;
+        uint8_t m_commit_stage;
+        uint8_t m_commit_source;
+        uint32_t m_commit_generation;
+        bool m_commit_success;
+        MemoryIoCallback_t m_commit_callback;
+        void *m_commit_context;
+        uint32_t m_commit_tag;
+        uint8_t m_sync_pending;                 /**< Outstanding device writes of write(). */
+        bool m_sync_failed[2];                  /**< The device write of write() failed. */
+    };
+
+#endif
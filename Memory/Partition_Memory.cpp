@@ -0,0 +1,158 @@
+#include "Partition_Memory.h"
+#include "MemoryManager_Debug.h"
+
+Partition_Table::Partition_Table(Memory &memory,
+                                 MemoryAddress_t memory_size,
+                                 const Partition_Memory_Config_t *partitions,
+                                 uint8_t number_of_partitions) : m_memory(&memory),
+                                                                 m_partitions(partitions),
+                                                                 m_number_of_partitions(number_of_partitions),
+                                                                 m_valid(false),
+                                                                 m_initialized(false)
+{
+    m_valid = validate(memory_size);
+}
+
+void Partition_Table::init(void)
+{
+    if (m_initialized == false)
+    {
+        m_memory->init();
+        m_initialized = true;
+    }
+}
+
+const Partition_Memory_Config_t *Partition_Table::partition(uint8_t idx) const
+{
+    return (m_valid && (idx < m_number_of_partitions)) ? &m_partitions[idx] : nullptr;
+}
+
+bool Partition_Table::validate(MemoryAddress_t memory_size)
+{
+    const Partition_Memory_Config_t *a, *b;
+
+    if (m_partitions == nullptr)
+    {
+        return false;
+    }
+
+    for (uint8_t i = 0; i < m_number_of_partitions; i++)
+    {
+        a = &m_partitions[i];
+        if ((a->size == 0) || ((uint64_t)a->base + a->size > memory_size))
+        {
+            DBIF_LOG_ERROR("Partition %i exceeds the Memory", i);
+            return false;
+        }
+
+        for (uint8_t j = i + 1u; j < m_number_of_partitions; j++)
+        {
+            b = &m_partitions[j];
+            if ((a->base < (uint64_t)b->base + b->size) && (b->base < (uint64_t)a->base + a->size))
+            {
+                DBIF_LOG_ERROR("Partition %i overlaps Partition %i", i, j);
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+Partition_Memory::Partition_Memory(Partition_Table &table, uint8_t idx) : Memory(),
+                                                                          m_table(&table),
+                                                                          m_config(table.partition(idx)),
+                                                                          m_written(false)
+{
+}
+
+void Partition_Memory::init(void)
+{
+    if (m_config == nullptr)
+    {
+        DBIF_LOG_ERROR("Invalid Partition");
+        return;
+    }
+    m_table->init();
+}
+
+MemoryAddress_t Partition_Memory::read(uint8_t* data_ptr, MemoryAddress_t start, MemoryAddress_t len)
+{
+    return in_range(start, len) ? m_table->memory()->read(data_ptr, m_config->base + start, len) : 0;
+}
+
+MemoryAddress_t Partition_Memory::write(uint8_t* data_ptr, MemoryAddress_t start, MemoryAddress_t len)
+{
+    MemoryAddress_t written_bytes = in_range(start, len) ? m_table->memory()->write(data_ptr, m_config->base + start, len) : 0;
+
+    m_written |= (written_bytes > 0);
+    return written_bytes;
+}
+
+bool Partition_Memory::commit(void)
+{
+    bool ret = (m_config != nullptr);
+
+    /* Only the range of this partition, other partitions keep their pending changes if the backend supports it */
+    if (ret && m_written)
+    {
+        ret = m_table->memory()->commit_range(m_config->base, m_config->size);
+        m_written = (ret == false);
+    }
+    return ret;
+}
+
+bool Partition_Memory::read_async(uint8_t* data_ptr, MemoryAddress_t start, MemoryAddress_t len, MemoryIoCallback_t callback, void *context, uint32_t tag)
+{
+    return in_range(start, len) && m_table->memory()->read_async(data_ptr, m_config->base + start, len, callback, context, tag);
+}
+
+bool Partition_Memory::write_async(uint8_t* data_ptr, MemoryAddress_t start, MemoryAddress_t len, MemoryIoCallback_t callback, void *context, uint32_t tag)
+{
+    bool ret = in_range(start, len) && m_table->memory()->write_async(data_ptr, m_config->base + start, len, callback, context, tag);
+
+    m_written |= ret;
+    return ret;
+}
+
+bool Partition_Memory::commit_async(MemoryIoCallback_t callback, void *context, uint32_t tag)
+{
+    bool success;
+
+    if (m_config == nullptr)
+    {
+        return false;
+    }
+
+    /* The range commit is synchronous and has to follow the outstanding writes */
+    while (m_table->memory()->busy())
+    {
+        m_table->memory()->poll();
+    }
+    success = commit();
+    if (callback != nullptr)
+    {
+        callback(context, tag, success);
+    }
+    return true;
+}
+
+void Partition_Memory::poll(void)
+{
+    m_table->memory()->poll();
+}
+
+bool Partition_Memory::busy(void)
+{
+    return m_table->memory()->busy();
+}
+
+bool Partition_Memory::in_range(MemoryAddress_t start, MemoryAddress_t len)
+{
+    bool ret = (m_config != nullptr) && ((uint64_t)start + len <= m_config->size);
+
+    if ((ret == false) && (m_config != nullptr))
+    {
+        DBIF_LOG_ERROR("Access %i+%i outside of Partition (size %i)", start, len, m_config->size);
+    }
+    return ret;
+}
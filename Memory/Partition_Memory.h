@@ -0,0 +1,95 @@
+#ifndef PARTITION_MEMORY_H
+#define PARTITION_MEMORY_H
+#include "Memory.h"
+
+struct Partition_Memory_Config_t
+{
+    MemoryAddress_t base;   /**< Start of the partition in the underlying Memory. */
+    MemoryAddress_t size;   /**< Size of the partition in bytes. */
+};
+
+/**
+ * @class Partition_Table
+ * @brief Splits one Memory into independent, non overlapping partitions.
+ *
+ * Each partition is accessed through a Partition_Memory and managed by its
+ * own MemoryManager, with its own header, verification and commits.
+ */
+class Partition_Table
+{
+
+    public:
+        Partition_Table(Memory &memory, MemoryAddress_t memory_size, const Partition_Memory_Config_t *partitions, uint8_t number_of_partitions);
+
+        /**
+         * @brief Returns true if all partitions are inside the memory and do not overlap.
+         */
+        bool valid(void) const { return m_valid; }
+
+        /**
+         * @brief Initializes the underlying Memory, only the first call has an effect.
+         */
+        void init(void);
+
+        /**
+         * @brief Returns the underlying Memory.
+         */
+        Memory *memory(void) { return m_memory; }
+
+        /**
+         * @brief Returns the configuration of a partition.
+         * @param idx Index of the partition.
+         * @return The configuration or nullptr if the index or the table is invalid.
+         */
+        const Partition_Memory_Config_t *partition(uint8_t idx) const;
+
+    private:
+        bool validate(MemoryAddress_t memory_size);
+
+    private:
+        Memory *m_memory;
+        const Partition_Memory_Config_t *m_partitions;
+        uint8_t m_number_of_partitions;
+        bool m_valid;
+        bool m_initialized;
+    };
+
+/**
+ * @class Partition_Memory
+ * @brief Memory view of one partition of a Partition_Table.
+ *
+ * Addresses are relative to the partition base, accesses outside of the
+ * partition fail. commit() commits the range of the partition through
+ * Memory::commit_range() and is skipped if nothing was written since the
+ * last commit. Log_Memory and Fault_Memory commit the range only.
+ * Backends which can only commit as a whole (EEPROM_Memory,
+ * Mirrored_Memory, Tiered_Memory) also commit the pending writes of the
+ * other partitions then, for them a partition is no isolation boundary.
+ * commit_async() waits for outstanding requests and commits synchronously.
+ */
+class Partition_Memory : public Memory
+{
+
+    public:
+        Partition_Memory(Partition_Table &table, uint8_t idx);
+        void init(void);
+        MemoryAddress_t read(uint8_t* data_ptr, MemoryAddress_t start, MemoryAddress_t len);
+        MemoryAddress_t write(uint8_t* data_ptr, MemoryAddress_t start, MemoryAddress_t len);
+        bool commit(void);
+
+        bool read_async(uint8_t* data_ptr, MemoryAddress_t start, MemoryAddress_t len, MemoryIoCallback_t callback, void *context, uint32_t tag);
+        bool write_async(uint8_t* data_ptr, MemoryAddress_t start, MemoryAddress_t len, MemoryIoCallback_t callback, void *context, uint32_t tag);
+        bool commit_async(MemoryIoCallback_t callback, void *context, uint32_t tag);
+        void poll(void);
+        bool busy(void);
+
+    private:
+        bool in_range(MemoryAddress_t start, MemoryAddress_t len);
+
+    private:
+        Partition_Table *m_table;
+        const Partition_Memory_Config_t *m_config;
+        bool m_written;     /**< Written since the last commit. */
+    };
+
+#endif
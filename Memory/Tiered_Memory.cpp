@@ -0,0 +1,494 @@
+#include <stddef.h>
+#include <string.h>
+#include "Tiered_Memory.h"
+#include "../MemoryCrc/MemoryCrc.h"
+#include "MemoryManager_Debug.h"
+
+#define TIERED_MEMORY_MAGIC         0x54494552u /* "TIER" */
+#define TIERED_MEMORY_COPY_CHUNK    64u
+#define TIERED_MEMORY_NO_EXTENT     0xFFFFFFFFu
+
+enum Tiered_Tier_e
+{
+    TIER_FAST = 0,
+    TIER_SLOW
+};
+
+Tiered_Memory::Tiered_Memory(Tiered_Memory_Config_t &config) : Memory(),
+                                                               m_config(&config),
+                                                               m_placement_count(0),
+                                                               m_fast_dirty(false),
+                                                               m_slow_dirty(false),
+                                                               m_migrate_ready(false),
+                                                               m_commit_pending(0),
+                                                               m_commit_success(true),
+                                                               m_commit_callback(nullptr),
+                                                               m_commit_context(nullptr),
+                                                               m_commit_tag(0)
+{
+    memset(&m_table, 0x00, sizeof(m_table));
+}
+
+void Tiered_Memory::init(void)
+{
+    m_config->fast->init();
+    m_config->slow->init();
+
+    m_config->fast->read(reinterpret_cast<uint8_t *>(&m_table), 0, sizeof(m_table));
+    if (table_valid() == false)
+    {
+        DBIF_LOG_DEBUG_0("No valid Placement Table, all Blocks in the slow Tier");
+        memset(&m_table, 0x00, sizeof(m_table));
+    }
+    m_fast_dirty = false;
+    m_slow_dirty = false;
+    m_migrate_ready = false;
+    m_placement_count = 0;
+}
+
+MemoryAddress_t Tiered_Memory::read(uint8_t* data_ptr, MemoryAddress_t start, MemoryAddress_t len)
+{
+    return transfer(data_ptr, start, len, false);
+}
+
+MemoryAddress_t Tiered_Memory::write(uint8_t* data_ptr, MemoryAddress_t start, MemoryAddress_t len)
+{
+    return transfer(data_ptr, start, len, true);
+}
+
+bool Tiered_Memory::commit(void)
+{
+    bool ret = true;
+
+    /* Only tiers with changes are committed, a small FRAM commit does not wait for the flash */
+    if (m_fast_dirty)
+    {
+        m_fast_dirty = (m_config->fast->commit() == false);
+        ret = (m_fast_dirty == false);
+    }
+    if (m_slow_dirty)
+    {
+        m_slow_dirty = (m_config->slow->commit() == false);
+        ret = ret && (m_slow_dirty == false);
+    }
+    m_migrate_ready = ret;
+    return ret;
+}
+
+bool Tiered_Memory::read_async(uint8_t* data_ptr, MemoryAddress_t start, MemoryAddress_t len, MemoryIoCallback_t callback, void *context, uint32_t tag)
+{
+    Memory *memory;
+    MemoryAddress_t offset;
+
+    if (route(start, len, memory, offset))
+    {
+        return memory->read_async(data_ptr, offset, len, callback, context, tag);
+    }
+    return Memory::read_async(data_ptr, start, len, callback, context, tag);
+}
+
+bool Tiered_Memory::write_async(uint8_t* data_ptr, MemoryAddress_t start, MemoryAddress_t len, MemoryIoCallback_t callback, void *context, uint32_t tag)
+{
+    Memory *memory;
+    MemoryAddress_t offset;
+
+    if (route(start, len, memory, offset))
+    {
+        m_fast_dirty |= (memory == m_config->fast);
+        m_slow_dirty |= (memory == m_config->slow);
+        return memory->write_async(data_ptr, offset, len, callback, context, tag);
+    }
+    return Memory::write_async(data_ptr, start, len, callback, context, tag);
+}
+
+bool Tiered_Memory::commit_async(MemoryIoCallback_t callback, void *context, uint32_t tag)
+{
+    bool fast = m_fast_dirty;
+    bool slow = m_slow_dirty;
+
+    if (m_commit_pending > 0)
+    {
+        return false;
+    }
+
+    m_commit_callback = callback;
+    m_commit_context = context;
+    m_commit_tag = tag;
+    m_commit_success = true;
+    m_commit_pending = (fast ? 1u : 0u) + (slow ? 1u : 0u) + 1u;
+
+    /* Both tiers commit in parallel, the request completes with the slower one */
+    if (fast && (m_config->fast->commit_async(&Tiered_Memory::commit_complete, this, TIER_FAST) == false))
+    {
+        commit_complete(this, TIER_FAST, false);
+    }
+    if (slow && (m_config->slow->commit_async(&Tiered_Memory::commit_complete, this, TIER_SLOW) == false))
+    {
+        commit_complete(this, TIER_SLOW, false);
+    }
+
+    /* Releases the extra count which keeps synchronous completions from finishing early */
+    commit_complete(this, TIERED_MEMORY_NO_EXTENT, true);
+    return true;
+}
+
+void Tiered_Memory::poll(void)
+{
+    m_config->fast->poll();
+    m_config->slow->poll();
+
+    /* Migrations commit themselves, they only run when both tiers hold committed data */
+    if (m_migrate_ready && (m_placement_count > 0) && (m_fast_dirty == false) && (m_slow_dirty == false) &&
+        (busy() == false))
+    {
+        migrate();
+    }
+}
+
+bool Tiered_Memory::busy(void)
+{
+    return (m_commit_pending > 0) || m_config->fast->busy() || m_config->slow->busy();
+}
+
+bool Tiered_Memory::place(MemoryAddress_t start, MemoryAddress_t len, MemoryBlockTemperature_e temperature)
+{
+    bool fast = (temperature == MemoryBlockTemperature_e::BLOCK_HOT) || (len <= m_config->small_block_size);
+    uint32_t idx = TIERED_MEMORY_NO_EXTENT;
+    uint32_t queued = m_placement_count;
+    uint32_t extents = m_table.count;
+    bool ret = true;
+
+    /* Extents once the other queued migrations have run */
+    for (uint32_t p = 0; p < m_placement_count; p++)
+    {
+        if ((m_placement[p].start == start) && (m_placement[p].len == len))
+        {
+            queued = p;
+        }
+        else
+        {
+            extents = m_placement[p].fast ? (extents + 1u) : (extents - 1u);
+        }
+    }
+
+    for (uint32_t i = 0; i < m_table.count; i++)
+    {
+        if ((m_table.extent[i].start == start) && (m_table.extent[i].len == len))
+        {
+            idx = i;
+        }
+    }
+
+    if (fast && (idx == TIERED_MEMORY_NO_EXTENT) && (extents >= TIERED_MEMORY_MAX_EXTENTS))
+    {
+        DBIF_LOG_ERROR("Placement Table full, %i+%i stays in the slow Tier", start, len);
+        ret = false;
+    }
+    else if (queued < m_placement_count)
+    {
+        /* A newer hint for the same range replaces the queued one */
+        m_placement[queued].fast = fast;
+    }
+    else if (fast != (idx != TIERED_MEMORY_NO_EXTENT))
+    {
+        if (m_placement_count < TIERED_MEMORY_MAX_EXTENTS)
+        {
+            m_placement[m_placement_count] = Tiered_Placement_t{start, len, fast};
+            m_placement_count++;
+        }
+        else
+        {
+            DBIF_LOG_ERROR("Placement Queue full, %i+%i stays in its Tier", start, len);
+            ret = false;
+        }
+    }
+    return ret;
+}
+
+bool Tiered_Memory::is_fast(MemoryAddress_t start)
+{
+    for (uint32_t i = 0; i < m_table.count; i++)
+    {
+        if ((start >= m_table.extent[i].start) && (start - m_table.extent[i].start < m_table.extent[i].len))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+MemoryAddress_t Tiered_Memory::transfer(uint8_t* data_ptr, MemoryAddress_t start, MemoryAddress_t len, bool write)
+{
+    MemoryAddress_t done = 0;
+    MemoryAddress_t pos, piece, offset, bytes;
+    Memory *memory;
+    Tiered_Extent_t *extent;
+
+    if ((data_ptr == NULL) || ((uint64_t)start + len > m_config->memory_size))
+    {
+        return 0;
+    }
+
+    /* Split the request at the borders of the fast extents */
+    while (done < len)
+    {
+        pos = start + done;
+        piece = len - done;
+        memory = m_config->slow;
+        offset = pos;
+
+        for (uint32_t i = 0; i < m_table.count; i++)
+        {
+            extent = &m_table.extent[i];
+            if ((pos >= extent->start) && (pos - extent->start < extent->len))
+            {
+                memory = m_config->fast;
+                offset = extent->fast_offset + (pos - extent->start);
+                piece = ((extent->start + extent->len - pos) < piece) ? (extent->start + extent->len - pos) : piece;
+            }
+            else if ((extent->start > pos) && (extent->start - pos < piece))
+            {
+                piece = extent->start - pos;
+            }
+        }
+
+        if (write)
+        {
+            bytes = memory->write(&data_ptr[done], offset, piece);
+            m_fast_dirty |= (memory == m_config->fast);
+            m_slow_dirty |= (memory == m_config->slow);
+        }
+        else
+        {
+            bytes = memory->read(&data_ptr[done], offset, piece);
+        }
+
+        if (bytes != piece)
+        {
+            break;
+        }
+        done += piece;
+    }
+    return done;
+}
+
+bool Tiered_Memory::route(MemoryAddress_t start, MemoryAddress_t len, Memory *&memory, MemoryAddress_t &offset)
+{
+    Tiered_Extent_t *extent;
+
+    if ((uint64_t)start + len > m_config->memory_size)
+    {
+        return false;
+    }
+
+    memory = m_config->slow;
+    offset = start;
+    for (uint32_t i = 0; i < m_table.count; i++)
+    {
+        extent = &m_table.extent[i];
+        if ((start >= extent->start) && (start - extent->start < extent->len))
+        {
+            memory = m_config->fast;
+            offset = extent->fast_offset + (start - extent->start);
+            if ((uint64_t)start + len > (uint64_t)extent->start + extent->len)
+            {
+                return false;
+            }
+        }
+        else if ((extent->start > start) && (extent->start - start < len))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool Tiered_Memory::promote(MemoryAddress_t start, MemoryAddress_t len)
+{
+    MemoryAddress_t fast_offset;
+    Tiered_Extent_t *extent;
+    bool ret;
+
+    /* Ranges of a previous layout are moved back first */
+    for (uint32_t i = 0; i < m_table.count;)
+    {
+        extent = &m_table.extent[i];
+        if ((extent->start < (uint64_t)start + len) && (start < (uint64_t)extent->start + extent->len))
+        {
+            if (demote(i) == false)
+            {
+                return false;
+            }
+        }
+        else
+        {
+            i++;
+        }
+    }
+
+    if ((m_table.count >= TIERED_MEMORY_MAX_EXTENTS) || (allocate(len, fast_offset) == false))
+    {
+        DBIF_LOG_ERROR("Fast Tier full, %i Bytes stay in the slow Tier", len);
+        return false;
+    }
+
+    DBIF_LOG_DEBUG_0("Promote %i+%i to the fast Tier", start, len);
+    ret = copy(m_config->slow, start, m_config->fast, fast_offset, len);
+    if (ret)
+    {
+        m_table.extent[m_table.count] = Tiered_Extent_t{start, len, fast_offset};
+        m_table.count++;
+        ret = save_table();
+    }
+    return ret;
+}
+
+bool Tiered_Memory::demote(uint32_t idx)
+{
+    Tiered_Extent_t extent = m_table.extent[idx];
+    bool ret;
+
+    DBIF_LOG_DEBUG_0("Demote %i+%i to the slow Tier", extent.start, extent.len);
+
+    /* The data has to be durable in the slow tier before the table drops the extent */
+    ret = copy(m_config->fast, extent.fast_offset, m_config->slow, extent.start, extent.len) &&
+          m_config->slow->commit();
+    if (ret)
+    {
+        m_table.count--;
+        m_table.extent[idx] = m_table.extent[m_table.count];
+        ret = save_table();
+    }
+    return ret;
+}
+
+bool Tiered_Memory::allocate(MemoryAddress_t len, MemoryAddress_t &fast_offset)
+{
+    MemoryAddress_t candidate;
+    bool fits;
+
+    /* First fit: the start of the data area or the end of an extent */
+    for (uint32_t c = 0; c <= m_table.count; c++)
+    {
+        candidate = (c == 0) ? sizeof(Tiered_Table_t) : (m_table.extent[c - 1u].fast_offset + m_table.extent[c - 1u].len);
+        fits = ((uint64_t)candidate + len <= m_config->fast_size);
+
+        for (uint32_t i = 0; (i < m_table.count) && fits; i++)
+        {
+            fits = (candidate >= (uint64_t)m_table.extent[i].fast_offset + m_table.extent[i].len) ||
+                   (m_table.extent[i].fast_offset >= (uint64_t)candidate + len);
+        }
+
+        if (fits)
+        {
+            fast_offset = candidate;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool Tiered_Memory::copy(Memory *source, MemoryAddress_t source_offset, Memory *destination, MemoryAddress_t destination_offset, MemoryAddress_t len)
+{
+    uint8_t buffer[TIERED_MEMORY_COPY_CHUNK];
+    MemoryAddress_t chunk;
+
+    for (MemoryAddress_t done = 0; done < len; done += chunk)
+    {
+        chunk = ((len - done) < TIERED_MEMORY_COPY_CHUNK) ? (len - done) : TIERED_MEMORY_COPY_CHUNK;
+        if ((source->read(buffer, source_offset + done, chunk) != chunk) ||
+            (destination->write(buffer, destination_offset + done, chunk) != chunk))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool Tiered_Memory::save_table(void)
+{
+    m_table.magic = TIERED_MEMORY_MAGIC;
+    m_table.crc = MemoryCrc_crc32(reinterpret_cast<uint8_t *>(&m_table), offsetof(Tiered_Table_t, crc));
+
+    return (m_config->fast->write(reinterpret_cast<uint8_t *>(&m_table), 0, sizeof(m_table)) == sizeof(m_table)) &&
+           m_config->fast->commit();
+}
+
+bool Tiered_Memory::table_valid(void)
+{
+    Tiered_Extent_t *extent;
+
+    if ((m_table.magic != TIERED_MEMORY_MAGIC) ||
+        (m_table.count > TIERED_MEMORY_MAX_EXTENTS) ||
+        (m_table.crc != MemoryCrc_crc32(reinterpret_cast<uint8_t *>(&m_table), offsetof(Tiered_Table_t, crc))))
+    {
+        return false;
+    }
+
+    for (uint32_t i = 0; i < m_table.count; i++)
+    {
+        extent = &m_table.extent[i];
+        if (((uint64_t)extent->start + extent->len > m_config->memory_size) ||
+            (extent->fast_offset < sizeof(Tiered_Table_t)) ||
+            ((uint64_t)extent->fast_offset + extent->len > m_config->fast_size))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+void Tiered_Memory::migrate(void)
+{
+    Tiered_Placement_t *placement;
+    uint32_t idx;
+
+    /* Runs from poll() after a commit, both tiers only hold committed data */
+    for (uint32_t p = 0; p < m_placement_count; p++)
+    {
+        placement = &m_placement[p];
+        idx = TIERED_MEMORY_NO_EXTENT;
+        for (uint32_t i = 0; i < m_table.count; i++)
+        {
+            if ((m_table.extent[i].start == placement->start) && (m_table.extent[i].len == placement->len))
+            {
+                idx = i;
+            }
+        }
+
+        if (placement->fast && (idx == TIERED_MEMORY_NO_EXTENT) && (promote(placement->start, placement->len) == false))
+        {
+            DBIF_LOG_ERROR("Promote of %i+%i failed", placement->start, placement->len);
+        }
+        else if ((placement->fast == false) && (idx != TIERED_MEMORY_NO_EXTENT) && (demote(idx) == false))
+        {
+            DBIF_LOG_ERROR("Demote of %i+%i failed", placement->start, placement->len);
+        }
+    }
+    m_placement_count = 0;
+}
+
+void Tiered_Memory::commit_complete(void *context, uint32_t tag, bool success)
+{
+    Tiered_Memory *memory = static_cast<Tiered_Memory *>(context);
+
+    if (success && (tag == TIER_FAST))
+    {
+        memory->m_fast_dirty = false;
+    }
+    if (success && (tag == TIER_SLOW))
+    {
+        memory->m_slow_dirty = false;
+    }
+    memory->m_commit_success = memory->m_commit_success && success;
+
+    memory->m_commit_pending--;
+    if (memory->m_commit_pending == 0)
+    {
+        memory->m_migrate_ready = memory->m_commit_success;
+    }
+    if ((memory->m_commit_pending == 0) && (memory->m_commit_callback != nullptr))
+    {
+        memory->m_commit_callback(memory->m_commit_context, memory->m_commit_tag, memory->m_commit_success);
+    }
+}
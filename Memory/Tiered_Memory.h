@@ -0,0 +1,114 @@
+#ifndef TIERED_MEMORY_H
+#define TIERED_MEMORY_H
+#include "Memory.h"
+
+/**
+ * @def TIERED_MEMORY_MAX_EXTENTS
+ * @brief Maximum number of ranges placed in the fast tier.
+ */
+#ifndef TIERED_MEMORY_MAX_EXTENTS
+#define TIERED_MEMORY_MAX_EXTENTS 16u
+#endif
+
+struct Tiered_Memory_Config_t
+{
+    Memory *fast;                       /**< Small device with fast, (almost) unlimited writes, e.g. FRAM. */
+    MemoryAddress_t fast_size;          /**< Size of the fast device, incl. the placement table. */
+    Memory *slow;                       /**< Large device holding the complete image, e.g. flash. */
+    MemoryAddress_t memory_size;        /**< Size of the image presented to the MemoryManager. */
+    MemoryAddress_t small_block_size;   /**< Blocks up to this size are placed in the fast tier even when cold. */
+};
+
+/**
+ * @class Tiered_Memory
+ * @brief Memory spread over a fast and a slow device by placement hints.
+ *
+ * The slow device holds the image at its original offsets. Ranges placed
+ * into the fast tier by place() (hot or small blocks) are copied into the
+ * fast device and read and written there, until they are placed back. The
+ * placement table is stored at the start of the fast device and written
+ * right after each migration, so a migration interrupted by a power loss
+ * leaves the previous placement valid.
+ *
+ * place() only queues the migration and fails if the queue or the placement
+ * table is full. Queued migrations run in poll() once a commit has succeeded
+ * and nothing has been written since, so they copy committed data only and
+ * their own commits do not persist writes of a pass which is still in
+ * progress. They never run inside a commit or its completion callback.
+ *
+ * commit() only commits the tiers written since the previous commit,
+ * commit_async() commits both tiers in parallel.
+ */
+class Tiered_Memory : public Memory
+{
+
+    public:
+        Tiered_Memory(Tiered_Memory_Config_t &config);
+        void init(void);
+        MemoryAddress_t read(uint8_t* data_ptr, MemoryAddress_t start, MemoryAddress_t len);
+        MemoryAddress_t write(uint8_t* data_ptr, MemoryAddress_t start, MemoryAddress_t len);
+        bool commit(void);
+
+        bool read_async(uint8_t* data_ptr, MemoryAddress_t start, MemoryAddress_t len, MemoryIoCallback_t callback, void *context, uint32_t tag);
+        bool write_async(uint8_t* data_ptr, MemoryAddress_t start, MemoryAddress_t len, MemoryIoCallback_t callback, void *context, uint32_t tag);
+        bool commit_async(MemoryIoCallback_t callback, void *context, uint32_t tag);
+        void poll(void);
+        bool busy(void);
+
+        bool place(MemoryAddress_t start, MemoryAddress_t len, MemoryBlockTemperature_e temperature);
+
+        /**
+         * @brief Returns true if the range starting at start is placed in the fast tier.
+         */
+        bool is_fast(MemoryAddress_t start);
+
+    private:
+        struct Tiered_Extent_t
+        {
+            MemoryAddress_t start;          /**< Start of the range in the image. */
+            MemoryAddress_t len;
+            MemoryAddress_t fast_offset;    /**< Location of the range in the fast device. */
+        };
+
+        struct Tiered_Placement_t
+        {
+            MemoryAddress_t start;
+            MemoryAddress_t len;
+            bool fast;                      /**< Target tier of the range. */
+        };
+
+        struct Tiered_Table_t
+        {
+            uint32_t magic;
+            uint32_t count;
+            Tiered_Extent_t extent[TIERED_MEMORY_MAX_EXTENTS];
+            uint32_t crc;
+        };
+
+        MemoryAddress_t transfer(uint8_t* data_ptr, MemoryAddress_t start, MemoryAddress_t len, bool write);
+        bool route(MemoryAddress_t start, MemoryAddress_t len, Memory *&memory, MemoryAddress_t &offset);
+        bool promote(MemoryAddress_t start, MemoryAddress_t len);
+        bool demote(uint32_t idx);
+        bool allocate(MemoryAddress_t len, MemoryAddress_t &fast_offset);
+        bool copy(Memory *source, MemoryAddress_t source_offset, Memory *destination, MemoryAddress_t destination_offset, MemoryAddress_t len);
+        bool save_table(void);
+        bool table_valid(void);
+        void migrate(void);
+        static void commit_complete(void *context, uint32_t tag, bool success);
+
+    private:
+        Tiered_Memory_Config_t *m_config;
+        Tiered_Table_t m_table;
+        Tiered_Placement_t m_placement[TIERED_MEMORY_MAX_EXTENTS];
+        uint32_t m_placement_count;
+        bool m_fast_dirty;
+        bool m_slow_dirty;
+        bool m_migrate_ready;           /**< A commit succeeded, queued migrations may run in poll(). */
+        uint8_t m_commit_pending;
+        bool m_commit_success;
+        MemoryIoCallback_t m_commit_callback;
+        void *m_commit_context;
+        uint32_t m_commit_tag;
+    };
+
+#endif
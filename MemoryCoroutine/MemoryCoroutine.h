@@ -0,0 +1,68 @@
+#ifndef MEMORY_COROUTINE_H
+#define MEMORY_COROUTINE_H
+
+#include "../MemoryManager_Types.h"
+
+#if MEMORRY_COROUTINE_ENABLED == true
+
+#if !defined(__cpp_impl_coroutine)
+    #error "MEMORRY_COROUTINE_ENABLED requires a C++20 compiler (-std=c++20)"
+#endif
+
+#include <coroutine>
+#include <exception>
+
+class MemoryManager;
+
+/**
+ * @class MemoryTask
+ * @brief Return type of application coroutines awaiting the MemoryManager.
+ *
+ * The coroutine starts running immediately and runs until its first
+ * co_await. It is resumed from MemoryManager::loop() once the awaited
+ * condition is met and releases its frame when it returns.
+ */
+struct MemoryTask
+{
+    struct promise_type
+    {
+        MemoryTask get_return_object(void) { return MemoryTask(); }
+        std::suspend_never initial_suspend(void) noexcept { return {}; }
+        std::suspend_never final_suspend(void) noexcept { return {}; }
+        void return_void(void) {}
+        void unhandled_exception(void) { std::terminate(); }
+    };
+};
+
+/**
+ * @class MemoryAwaitable
+ * @brief Awaitable returned by MemoryManager::flush(), sync() and load().
+ *
+ * co_await yields true if the awaited operation was successful.
+ */
+class MemoryAwaitable
+{
+public:
+    MemoryAwaitable(MemoryManager *manager, MemoryManagerWait_e kind, uint16_t entry_idx) : m_manager(manager),
+                                                                                           m_kind(kind),
+                                                                                           m_entry_idx(entry_idx),
+                                                                                           m_result(false)
+    {
+    }
+
+    bool await_ready(void);
+    bool await_suspend(std::coroutine_handle<> handle);
+    bool await_resume(void) { return m_result; }
+
+private:
+    static void resume(void *handle) { std::coroutine_handle<>::from_address(handle).resume(); }
+
+    MemoryManager *m_manager;
+    MemoryManagerWait_e m_kind;
+    uint16_t m_entry_idx;
+    bool m_result;
+};
+
+#endif
+
+#endif
@@ -5,9 +5,36 @@
 
 #if MEMORRY_CRC_ENABLED == true
 
-inline static uint32_t MemoryCrc_calculate_crc(MemoryCrcType_e type, uint8_t* data, uint32_t data_len) 
+inline static uint32_t MemoryCrc_calculate_crc(MemoryCrcType_e type, uint8_t* data, uint32_t data_len)
 {
         return Crc::calculate(static_cast<Crc::CrcType_e>(type), data,  data_len);
 }
 #endif
-#endif
\ No newline at end of file
+
+/**
+ * @brief Software CRC32 (IEEE 802.3, reflected) which is always available.
+ *
+ * Used for internal integrity checks (log records, header) which must not
+ * depend on MEMORRY_CRC_ENABLED. The calculation can be continued over
+ * several buffers by passing the previous result as @p crc.
+ *
+ * @param data Pointer to the data.
+ * @param data_len Number of bytes.
+ * @param crc Result of a previous call or 0 to start a new calculation.
+ * @return The CRC32 value.
+ */
+inline static uint32_t MemoryCrc_crc32(const uint8_t* data, uint32_t data_len, uint32_t crc = 0)
+{
+    crc = ~crc;
+    for (uint32_t i = 0; i < data_len; i++)
+    {
+        crc ^= data[i];
+        for (uint8_t bit = 0; bit < 8; bit++)
+        {
+            crc = (crc >> 1) ^ (0xEDB88320u & (0u - (crc & 1u)));
+        }
+    }
+    return ~crc;
+}
+
+#endif
@@ -4,9 +4,28 @@
 #include <vector>
 #include "../MemoryManager_Types.h"
 #include "LinkedList.h"
+#include "MemoryStaticList.h"
 
+#if MEMORRY_BLOCK_CAPACITY > 0
+/* One entry more for the header block */
+using MemoryManagerBlockList = MemoryStaticList<MemoryManagerBlock, MEMORRY_BLOCK_CAPACITY + 1>;
+using MemoryManagerBlockParamList = MemoryStaticList<MemoryBlockParams_t*, MEMORRY_BLOCK_CAPACITY + 1>;
+using MemoryManagerBlockStateList = MemoryStaticList<MemoryBlockState_t, MEMORRY_BLOCK_CAPACITY + 1>;
+using MemoryManagerBlockOrder = MemoryStaticList<uint16_t, MEMORRY_BLOCK_CAPACITY + 1>;
+using MemoryManagerWaiterList = MemoryStaticList<MemoryManagerWaiter_t, MEMORRY_BLOCK_CAPACITY + 1>;
+using MemoryManagerSubscriberList = MemoryStaticList<MemoryManagerSubscriber_t, MEMORRY_SUBSCRIBER_CAPACITY>;
+using MemoryManagerIoList = MemoryStaticList<MemoryAddress_t, MEMORRY_IO_CAPACITY>;
+using MemoryManagerFieldTimeList = MemoryStaticList<uint32_t, MEMORRY_FIELD_CAPACITY>;
+#else
 using MemoryManagerBlockList = std::vector<MemoryManagerBlock>;
 using MemoryManagerBlockParamList = std::vector<MemoryBlockParams_t*>;
+using MemoryManagerBlockStateList = std::vector<MemoryBlockState_t>;
+using MemoryManagerBlockOrder = std::vector<uint16_t>;
+using MemoryManagerWaiterList = std::vector<MemoryManagerWaiter_t>;
+using MemoryManagerSubscriberList = std::vector<MemoryManagerSubscriber_t>;
+using MemoryManagerIoList = std::vector<MemoryAddress_t>;
+using MemoryManagerFieldTimeList = std::vector<uint32_t>;
+#endif
 
 
 #endif
\ No newline at end of file
@@ -0,0 +1,76 @@
+#ifndef MEMORY_STATIC_LIST_H
+#define MEMORY_STATIC_LIST_H
+
+#include <stdint.h>
+
+/**
+ * @class MemoryStaticList
+ * @brief Statically allocated list with the subset of the std::vector interface used by the MemoryManager.
+ *
+ * The elements are stored in a member array of fixed capacity, so the list
+ * never allocates and pointers to its elements stay valid while elements
+ * are only added. push_back() on a full list leaves the list unchanged and
+ * returns false, erase() of an empty list or of a position outside the list
+ * leaves it unchanged and returns end().
+ *
+ * @tparam T Element type, has to be default constructible.
+ * @tparam CAPACITY Maximum number of elements.
+ */
+template <typename T, uint16_t CAPACITY>
+class MemoryStaticList
+{
+public:
+    typedef T *iterator;
+    typedef const T *const_iterator;
+
+    MemoryStaticList() : m_size(0) {}
+
+    bool push_back(const T &value)
+    {
+        if (m_size >= CAPACITY)
+        {
+            return false;
+        }
+        m_data[m_size++] = value;
+        return true;
+    }
+
+    iterator erase(iterator position)
+    {
+        /* An empty list or a position outside of it is left unchanged */
+        if ((m_size == 0) || (position < begin()) || (position >= end()))
+        {
+            return end();
+        }
+
+        for (iterator it = position; (it + 1) < end(); it++)
+        {
+            *it = *(it + 1);
+        }
+        m_size--;
+        return position;
+    }
+
+    void clear(void) { m_size = 0; }
+    void reserve(uint16_t) {}
+
+    uint16_t size(void) const { return m_size; }
+    uint16_t max_size(void) const { return CAPACITY; }
+    bool empty(void) const { return m_size == 0; }
+
+    T &operator[](uint16_t idx) { return m_data[idx]; }
+    const T &operator[](uint16_t idx) const { return m_data[idx]; }
+    T &at(uint16_t idx) { return m_data[idx]; }
+    const T &at(uint16_t idx) const { return m_data[idx]; }
+
+    iterator begin(void) { return &m_data[0]; }
+    iterator end(void) { return &m_data[m_size]; }
+    const_iterator begin(void) const { return &m_data[0]; }
+    const_iterator end(void) const { return &m_data[m_size]; }
+
+private:
+    T m_data[CAPACITY];
+    uint16_t m_size;
+};
+
+#endif
@@ -1,57 +1,123 @@
+#include <stddef.h>
 #include "MemoryManager.h"
 #include "MemoryManager_Types.h"
 #include "MemoryManager_Debug.h"
+#include "MemoryCrc/MemoryCrc.h"
 
 
-static MemoryManagerHeader_t header = {
-    .version{0, 0, 0},
-    .key = MemoryManagerStatus_e::STATUS_UNINIT,
-
-#if MEMORRY_CRC_ENABLED == true
-    .crc = 0x00000000,
-#endif
-
-};
-
-static MemoryManagerHeader_t eeprom_header = {
-    .version{0, 0, 0},
-    .key = MemoryManagerStatus_e::STATUS_UNINIT,
-
-#if MEMORRY_CRC_ENABLED == true
-    .crc = 0x00000000,
-#endif
-};
-
-static MemoryManagerHeader_t default_header = {
+/* Initial content of the header buffers, every manager owns its own copy */
+static const MemoryManagerHeader_t header_init = {
     .version{0, 0, 0},
     .key = MemoryManagerStatus_e::STATUS_UNINIT,
 
 #if MEMORRY_CRC_ENABLED == true
     .crc = 0x00000000,
 #endif
+    .format = MEMORY_HEADER_FORMAT,
+    .generation = 0,
+    .shutdown = MemoryManagerStatus_e::STATUS_UNINIT,
+    .header_crc = 0x00000000,
 };
 
-static MemoryManagerBlock header_block((uint8_t *)&header,
-                                       (uint8_t *)&eeprom_header,
-                                       sizeof(MemoryManagerHeader_t),
-                                       (uint8_t *)&default_header);
-                                      
-
-MemoryManager::MemoryManager() : m_memory_interface(NULL)
+MemoryManager::MemoryManager() : m_memory_interface(NULL),
+                                 m_load_mode(MemoryManagerLoad_e::LOAD_ALL_BLOCKS),
+                                 m_prefetch_idx(0),
+                                 m_loop_cursor(0),
+                                 m_loop_written(false),
+                                 m_commit_policy{0, 0, 0},
+                                 m_uncommitted(false),
+                                 m_uncommitted_bytes(0),
+                                 m_uncommitted_since_ms(0),
+                                 m_last_commit_ms(0),
+                                 m_heat_policy{0, 0, 0, 0},
+                                 m_cold_written(false),
+                                 m_io_async(false),
+                                 m_io_pending(0),
+                                 m_io_flush_start_us(0),
+                                 m_io_commit_start_us(0),
+                                 m_waiter_list(),
+                                 m_pass_count(0),
+                                 m_sync_pass(0),
+                                 m_sync_active(false),
+                                 m_pass_ok(true),
+                                 m_subscriber_list(),
+                                 m_change_driven(false),
+                                 m_change_pending(false),
+                                 m_transaction_active(false),
+                                 m_verify_blocks(true),
+                                 m_size_valid(true),
+                                 m_factory_image(NULL),
+                                 m_factory_image_size(0),
+                                 m_header(header_init),
+                                 m_memory_header(header_init),
+                                 m_default_header(header_init)
 {
-    add_block(header_block);
+    add_header_block();
     DBIF_INIT(9600);
 }
 
-MemoryManager::MemoryManager(Memory &interface, MemoryManagerConfig_t &config) : m_memory_interface(&interface)
+MemoryManager::MemoryManager(Memory &interface, MemoryManagerConfig_t &config) : m_memory_interface(&interface),
+                                                                                 m_load_mode(MemoryManagerLoad_e::LOAD_ALL_BLOCKS),
+                                                                                 m_prefetch_idx(0),
+                                                                                 m_loop_cursor(0),
+                                                                                 m_loop_written(false),
+                                                                                 m_commit_policy{0, 0, 0},
+                                                                                 m_uncommitted(false),
+                                                                                 m_uncommitted_bytes(0),
+                                                                                 m_uncommitted_since_ms(0),
+                                                                                 m_last_commit_ms(0),
+                                                                                 m_heat_policy{0, 0, 0, 0},
+                                                                                 m_cold_written(false),
+                                                                                 m_io_async(false),
+                                                                                 m_io_pending(0),
+                                                                                 m_io_flush_start_us(0),
+                                                                                 m_io_commit_start_us(0),
+                                                                                 m_waiter_list(),
+                                                                                 m_pass_count(0),
+                                                                                 m_sync_pass(0),
+                                                                                 m_sync_active(false),
+                                                                                 m_pass_ok(true),
+                                                                                 m_subscriber_list(),
+                                                                                 m_change_driven(false),
+                                                                                 m_change_pending(false),
+                                                                                 m_transaction_active(false),
+                                                                                 m_verify_blocks(true),
+                                                                                 m_size_valid(true),
+                                                                                 m_factory_image(NULL),
+                                                                                 m_factory_image_size(0),
+                                                                                 m_header(header_init),
+                                                                                 m_memory_header(header_init),
+                                                                                 m_default_header(header_init)
 {
-    add_block(header_block);
+    add_header_block();
     add_config(config);
 }
 
+void MemoryManager::add_header_block(void)
+{
+    MemoryManagerBlock header_block(reinterpret_cast<uint8_t *>(&m_header),
+                                    reinterpret_cast<uint8_t *>(&m_memory_header),
+                                    sizeof(MemoryManagerHeader_t),
+                                    reinterpret_cast<uint8_t *>(&m_default_header));
+    add_block(header_block);
+}
+
 void MemoryManager::add_config(MemoryManagerConfig_t &config)
 {
     m_current_version = config.version;
+    m_load_mode = config.load_mode;
+    m_commit_policy = config.commit_policy;
+    m_heat_policy = config.heat_policy;
+    if ((m_heat_policy.half_life_ms != 0) &&
+        ((m_heat_policy.hot_threshold == 0) || (m_heat_policy.cold_threshold >= m_heat_policy.hot_threshold)))
+    {
+        DBIF_LOG_ERROR("Invalid Heat Policy, hot_threshold %i has to exceed cold_threshold %i, classification disabled",
+                       m_heat_policy.hot_threshold, m_heat_policy.cold_threshold);
+        m_heat_policy.half_life_ms = 0;
+    }
+    m_change_driven = config.change_driven;
+    m_factory_image = config.factory_image;
+    m_factory_image_size = config.factory_image_size;
     for (uint16_t i = 0; i < config.number_of_storage; i++)
     {
         add_block(config.storage[i]);
@@ -66,31 +132,714 @@ void MemoryManager::add_interface(Memory &interface)
 void MemoryManager::begin(void)
 {
     MemoryManagerStatus_e status = MemoryManagerStatus_e::STATUS_ERROR;
+    uint32_t start_us = MemoryStats::now_us();
+    uint8_t probe;
 
     m_memory_interface->init();
+
+    /* The last byte of the image and of the journal behind it has to be addressable on the memory */
+    m_size_valid = (m_memory_interface->read(&probe, required_size() - 1u, 1) == 1);
+    if (m_size_valid == false)
+    {
+        DBIF_LOG_ERROR("Memory too small, %i Bytes required for the Image and the Transaction Journal", required_size());
+    }
+
     read_entry(MEMORY_HEADER_ENTRY);
+    m_memory_block_state_list[MEMORY_HEADER_ENTRY].loaded = true;
+
+    m_verify_blocks = (header_is_clean() == false);
+    if (m_verify_blocks == false)
+    {
+        DBIF_LOG_DEBUG_0("Clean Shutdown detected, skip Memory Verification");
+        status = load_verified_memory();
+    }
 
     for(uint16_t i = 0; ((i < 2) && (status != MemoryManagerStatus_e::STATUTS_OK)); i++)
     {
         status = verify_memory();       
     }
     set_memory_verification(status);
+
+#if MEMORRY_TRANSACTION_ENABLED == true
+    /* A journal only matches the layout of an image which is up to date */
+    if (status == MemoryManagerStatus_e::STATUTS_OK)
+    {
+        replay_journal();
+    }
+#endif
+
+    for (uint16_t i = 0; i < m_memory_block_list.size(); i++)
+    {
+        place_block(i);
+    }
+
+    /* Until the next shutdown() the image is considered unclean */
+    write_header(MemoryManagerStatus_e::STATUS_NOT_OK, true);
+    write_to_memory();
+
+    m_stats.started(MemoryStats::now_us() - start_us);
 }
 
 void MemoryManager::loop()
+{
+    loop(MemoryManagerBudget_t{0, 0});
+}
+
+void MemoryManager::loop(const MemoryManagerBudget_t &budget)
 {   
     bool written = false; 
-    written = write_all(MemoryBlockWrite_e::WRITE_ON_CHANGE,MemoryManagerType_e::USER_DATA);
-    if (written)
+    /* The timer is only read for a time budget or the statistics */
+    uint32_t start_us = (budget.time_us > 0) ? MemoryTimer::now_us() : MemoryStats::now_us();
+    uint32_t bytes = 0;
+    uint32_t block_bytes;
+    bool budget_left = true;
+
+    /* Completes asynchronous requests and runs deferred work of the backend, e.g. tier migrations */
+    m_memory_interface->poll();
+
+#if MEMORRY_ASYNC_ENABLED == true
+    if (m_io_pending > 0)
+    {
+        /* Flush in progress, the transfer runs without the CPU */
+        m_stats.looped(MemoryStats::now_us() - start_us);
+        return;
+    }
+#endif
+
+    if (m_transaction_active)
+    {
+        /* The blocks of the open transaction must not be written one by one */
+        return;
+    }
+
+#if MEMORRY_COROUTINE_ENABLED == true
+    resume_waiters();
+#endif
+
+    if (m_change_driven && (m_loop_cursor == 0) && (work_pending() == false))
+    {
+        /* Idle, nothing has been reported by block_changed() */
+        return;
+    }
+
+    if (m_load_mode == MemoryManagerLoad_e::LOAD_ON_DEMAND_PREFETCH)
+    {
+        prefetch();
+    }
+
+#if MEMORRY_ASYNC_ENABLED == true
+    m_io_async = true;
+    m_io_flush_start_us = start_us;
+#endif
+
+    if (m_loop_cursor == 0)
+    {
+        flush_order(m_flush_order);
+        m_sync_active = (m_sync_pass > m_pass_count);
+        m_pass_ok = true;
+        m_change_pending = false;
+    }
+
+    for (; (m_loop_cursor < m_flush_order.size()) && budget_left; m_loop_cursor++)
+    {
+        block_bytes = write_block(m_flush_order[m_loop_cursor], MemoryBlockWrite_e::WRITE_ON_CHANGE, MemoryManagerType_e::USER_DATA, written);
+        bytes += block_bytes;
+        m_loop_written |= written;
+
+        if (block_bytes > 0)
+        {
+            m_pass_ok &= written;
+            if (m_uncommitted == false)
+            {
+                m_uncommitted_since_ms = MemoryTimer::now_ms();
+            }
+            m_uncommitted = true;
+            m_uncommitted_bytes += block_bytes;
+        }
+
+        budget_left = ((budget.bytes == 0) || (bytes < budget.bytes)) &&
+                      ((budget.time_us == 0) || ((MemoryTimer::now_us() - start_us) < budget.time_us));
+    }
+
+    if (m_loop_cursor >= m_flush_order.size())
+    {
+        /* Pass complete, all changed blocks are in memory */
+        if (m_uncommitted && (m_cold_written || m_sync_active || commit_due()))
+        {
+            mark_unclean();
+            write_to_memory();
+            if (m_io_async == false)
+            {
+                m_stats.flushed(MemoryStats::now_us() - start_us);
+            }
+        }
+        else if (m_loop_written)
+        {
+            m_stats.coalesced();
+        }
+        m_loop_cursor = 0;
+        m_loop_written = false;
+        m_sync_active = false;
+        m_pass_count++;
+
+        /* Blocks which are no longer written cool down without a change */
+        for (uint16_t i = 1; (i < m_memory_block_state_list.size()) && (m_heat_policy.half_life_ms != 0); i++)
+        {
+            if (m_memory_block_state_list[i].hot)
+            {
+                decay_write_rate(i, MemoryTimer::now_ms());
+            }
+        }
+    }
+    m_io_async = false;
+
+#if MEMORRY_COROUTINE_ENABLED == true
+    resume_waiters();
+#endif
+    m_stats.looped(MemoryStats::now_us() - start_us);
+}
+
+void MemoryManager::block_changed(uint16_t entry_idx)
+{
+    if ((entry_idx != MEMORY_HEADER_ENTRY) && (entry_idx < m_memory_block_list.size()))
+    {
+        m_change_pending = true;
+        m_memory_block_state_list[entry_idx].change_reported = true;
+#if MEMORRY_TRANSACTION_ENABLED == true
+        m_memory_block_state_list[entry_idx].in_transaction |= m_transaction_active;
+#endif
+        publish(EVENT_BLOCK_CHANGED, entry_idx);
+    }
+}
+
+bool MemoryManager::subscribe(uint32_t mask, MemoryManagerEventCallback_t callback, void *context)
+{
+    if ((callback == nullptr) || (m_subscriber_list.size() >= m_subscriber_list.max_size()))
+    {
+        return false;
+    }
+    m_subscriber_list.push_back(MemoryManagerSubscriber_t{mask, callback, context});
+    return true;
+}
+
+void MemoryManager::unsubscribe(MemoryManagerEventCallback_t callback, void *context)
+{
+    for (uint16_t i = 0; i < m_subscriber_list.size();)
+    {
+        if ((m_subscriber_list[i].callback == callback) && (m_subscriber_list[i].context == context))
+        {
+            m_subscriber_list.erase(m_subscriber_list.begin() + i);
+        }
+        else
+        {
+            i++;
+        }
+    }
+}
+
+#if MEMORRY_TRANSACTION_ENABLED == true
+bool MemoryManager::begin_transaction(void)
+{
+    if (m_transaction_active || (m_size_valid == false))
+    {
+        return false;
+    }
+    wait_io();
+
+    for (uint16_t i = 1; i < m_memory_block_state_list.size(); i++)
+    {
+        m_memory_block_state_list[i].in_transaction = false;
+    }
+    m_transaction_active = true;
+    return true;
+}
+
+bool MemoryManager::commit_transaction(void)
+{
+    MemoryJournalHeader_t journal = {MEMORY_JOURNAL_MAGIC, 0, 0, 0, 0};
+    MemoryJournalEntry_t entry = {0, 0, 0};
+    MemoryManagerBlock *block;
+    MemoryBlockState_t *state;
+    MemoryAddress_t start = journal_offset();
+    MemoryAddress_t offset = start + sizeof(MemoryJournalHeader_t);
+    uint32_t crc = 0;
+    uint32_t bytes;
+    uint16_t entry_idx;
+    uint16_t members = 0;
+    bool written;
+    bool applied = true;
+    bool ret = true;
+
+    if (m_transaction_active == false)
+    {
+        return false;
+    }
+    wait_io();
+
+    /* Only blocks reported as changed since begin_transaction() are part of the transaction,
+       the members are marked in their state instead of being collected in a list */
+    if (m_loop_cursor == 0)
+    {
+        flush_order(m_flush_order);
+    }
+    for (uint16_t i = 0; (i < m_flush_order.size()) && ret; i++)
+    {
+        entry_idx = m_flush_order[i];
+        block = &m_memory_block_list[entry_idx];
+        state = &m_memory_block_state_list[entry_idx];
+        state->journaled = false;
+        if (state->in_transaction && is_loaded(entry_idx) &&
+            (compare_entry(entry_idx) == MemoryDataCompare_e::MEMORY_DATA_NOT_EQUAL))
+        {
+            if ((offset + sizeof(MemoryJournalEntry_t) + block->data_length()) > (start + MEMORRY_JOURNAL_SIZE))
+            {
+                DBIF_LOG_ERROR("Transaction does not fit into the Journal, increase MEMORRY_JOURNAL_SIZE");
+                ret = false;
+                break;
+            }
+
+            entry.entry_idx = entry_idx;
+            entry.length = block->data_length();
+            ret = (memory_write(entry_idx, MEMORY_IO_DATA, reinterpret_cast<uint8_t *>(&entry), offset, sizeof(entry)) > 0) &&
+                  (memory_write(entry_idx, MEMORY_IO_DATA, block->user_data(), offset + sizeof(entry), entry.length) > 0);
+            crc = MemoryCrc_crc32(reinterpret_cast<uint8_t *>(&entry), sizeof(entry), crc);
+            crc = MemoryCrc_crc32(block->user_data(), entry.length, crc);
+            offset += sizeof(entry) + entry.length;
+            state->journaled = true;
+            members++;
+        }
+    }
+
+    if (ret && (members > 0))
+    {
+        journal.count = members;
+        journal.length = offset - start - sizeof(MemoryJournalHeader_t);
+        journal.crc = MemoryCrc_crc32(reinterpret_cast<uint8_t *>(&journal), offsetof(MemoryJournalHeader_t, crc), crc);
+        mark_unclean();
+
+        /* The commit of the journal is the point the transaction becomes durable */
+        ret = (memory_write(MEMORY_HEADER_ENTRY, MEMORY_IO_DATA, reinterpret_cast<uint8_t *>(&journal), start, sizeof(journal)) > 0) &&
+              write_to_memory();
+    }
+
+    if (ret == false)
+    {
+        DBIF_LOG_ERROR("Transaction Journal could not be written");
+        return false;
+    }
+
+    for (uint16_t i = 0; i < m_flush_order.size(); i++)
+    {
+        entry_idx = m_flush_order[i];
+        state = &m_memory_block_state_list[entry_idx];
+        if (state->journaled == false)
+        {
+            continue;
+        }
+        state->journaled = false;
+        state->in_transaction = false;
+        written = false;
+        bytes = write_block(entry_idx, MemoryBlockWrite_e::WRITE_ALL_BLOCKS, MemoryManagerType_e::USER_DATA, written);
+        applied = applied && written;
+        if (m_uncommitted == false)
+        {
+            m_uncommitted_since_ms = MemoryTimer::now_ms();
+        }
+        m_uncommitted = true;
+        m_uncommitted_bytes += bytes;
+    }
+    /* A failed write in place is repaired by the replay during the next begin() */
+    if ((members > 0) && applied)
+    {
+        invalidate_journal();
+    }
+
+    m_transaction_active = false;
+    return true;
+}
+
+void MemoryManager::abort_transaction(void)
+{
+    MemoryManagerBlock *block;
+
+    for (uint16_t i = 1; (i < m_memory_block_list.size()) && m_transaction_active; i++)
+    {
+        block = &m_memory_block_list[i];
+        if (m_memory_block_state_list[i].in_transaction && is_loaded(i))
+        {
+            copy_data(block->eeprom_data(), block->user_data(), block->data_length());
+        }
+        m_memory_block_state_list[i].in_transaction = false;
+    }
+    m_transaction_active = false;
+}
+#endif
+
+MemoryAddress_t MemoryManager::factory_image(uint8_t *buffer, MemoryAddress_t size)
+{
+    MemoryManagerHeader_t header = m_default_header;
+    MemoryFactoryImageTrailer_t trailer;
+    MemoryBlockParams_t params;
+    MemoryManagerBlock *block;
+    MemoryAddress_t offset = 0;
+    uint8_t *data;
+
+    if ((buffer == NULL) || (size < factory_image_size()))
+    {
+        return 0;
+    }
+
+    header.version = m_current_version;
+    header.generation = 0;
+    header.shutdown = MemoryManagerStatus_e::STATUTS_OK;
+    header.header_crc = MemoryCrc_crc32(reinterpret_cast<uint8_t *>(&header), offsetof(MemoryManagerHeader_t, header_crc));
+
+    /* Same layout as get_offest(): data followed by the block parameter */
+    for (uint16_t i = 0; i < m_memory_block_list.size(); i++)
+    {
+        block = &m_memory_block_list[i];
+        data = (i == MEMORY_HEADER_ENTRY) ? reinterpret_cast<uint8_t *>(&header) : block->default_data();
+        if (data != NULL)
+        {
+            memcpy(&buffer[offset], data, block->data_length());
+        }
+        else
+        {
+            memset(&buffer[offset], 0x00, block->data_length());
+        }
+        offset += block->data_length();
+
+        params = *block->bock_parameter();
+        params.status = MemoryManagerStatus_e::STATUTS_OK;
+        params.crc = block_crc(block, params, &buffer[offset - block->data_length()]);
+        memcpy(&buffer[offset], &params, sizeof(MemoryBlockParams_t));
+        offset += sizeof(MemoryBlockParams_t);
+    }
+
+    /* Lets the target reject an image of another layout or a corrupted one before writing it */
+    trailer.magic = MEMORY_FACTORY_IMAGE_MAGIC;
+    trailer.layout_hash = layout_hash();
+    trailer.image_crc = MemoryCrc_crc32(buffer, offset);
+    memcpy(&buffer[offset], &trailer, sizeof(trailer));
+    return offset + sizeof(trailer);
+}
+
+bool MemoryManager::export_snapshot(MemorySnapshotSink &sink)
+{
+    MemorySnapshotWriter writer(sink);
+    MemorySnapshotHeader_t header;
+    MemorySnapshotDirEntry_t entry = {0, 0, 0};
+    MemoryManagerBlock *block;
+    bool ret;
+
+    wait_io();
+    header.block_count = m_memory_block_list.size();
+    header.version = m_memory_header.version.u32;
+    header.image_size = get_offest(m_memory_block_list.size());
+    header.params_size = sizeof(MemoryBlockParams_t);
+    ret = writer.header(header);
+
+    for (uint16_t i = 0; (i < m_memory_block_list.size()) && ret; i++)
+    {
+        /* Blocks which are not loaded yet are read into their memory mirror */
+        block = get_block(i);
+        entry.offset += entry.length + ((i > 0) ? sizeof(MemoryBlockParams_t) : 0u);
+        entry.length = block->data_length();
+        entry.crc = MemoryCrc_crc32(block->eeprom_data(), block->data_length());
+        entry.crc = MemoryCrc_crc32(reinterpret_cast<uint8_t *>(block->bock_parameter()), sizeof(MemoryBlockParams_t), entry.crc);
+        ret = writer.directory_entry(entry);
+    }
+    ret = ret && writer.directory_end();
+
+    for (uint16_t i = 0; (i < m_memory_block_list.size()) && ret; i++)
+    {
+        block = &m_memory_block_list[i];
+        ret = writer.image(block->eeprom_data(), block->data_length()) &&
+              writer.image(reinterpret_cast<uint8_t *>(block->bock_parameter()), sizeof(MemoryBlockParams_t));
+    }
+    ret = ret && writer.finish();
+
+    if (ret == false)
+    {
+        DBIF_LOG_ERROR("Snapshot Export failed");
+    }
+    return ret;
+}
+
+bool MemoryManager::import_snapshot(MemorySnapshotSource &source)
+{
+    MemorySnapshotReader reader(source);
+    MemorySnapshotHeader_t header;
+    MemorySnapshotDirEntry_t entry;
+    uint8_t chunk[MEMORRY_SNAPSHOT_CHUNK_SIZE];
+    MemoryManagerBlock *block;
+    MemoryAddress_t offset = 0;
+    uint32_t directory_crc = 0;
+    uint32_t image_crc = 0;
+    uint32_t chunk_offset;
+    uint32_t chunk_len;
+    bool verify_blocks = m_verify_blocks;
+    bool ret;
+
+    wait_io();
+    ret = reader.header(header) &&
+          (header.version == m_current_version.u32) &&
+          (header.block_count == m_memory_block_list.size()) &&
+          (header.params_size == sizeof(MemoryBlockParams_t)) &&
+          (header.image_size == get_offest(m_memory_block_list.size()));
+
+    for (uint16_t i = 0; (i < header.block_count) && ret; i++)
+    {
+        ret = reader.directory_entry(entry) &&
+              (entry.offset == offset) &&
+              (entry.length == m_memory_block_list[i].data_length());
+        directory_crc = MemoryCrc_crc32(reinterpret_cast<uint8_t *>(&entry), sizeof(entry), directory_crc);
+        offset += entry.length + sizeof(MemoryBlockParams_t);
+    }
+    ret = ret && reader.directory_end();
+
+    if (ret == false)
+    {
+        DBIF_LOG_ERROR("Snapshot does not match the Version or Block Layout");
+        return false;
+    }
+
+    /* The memory mirrors are the staging area, every block has to be loaded to restore them from memory */
+    for (uint16_t i = 0; i < m_memory_block_list.size(); i++)
+    {
+        get_block(i);
+    }
+
+    while (ret && reader.remaining())
+    {
+        ret = reader.chunk(chunk, chunk_offset, chunk_len);
+        if (ret)
+        {
+            stage_image(chunk, chunk_offset, chunk_len);
+        }
+    }
+    ret = ret && reader.finish();
+
+    /* The directory is rebuilt from the staged image like export_snapshot() does, it has to match the one read */
+    entry = MemorySnapshotDirEntry_t{0, 0, 0};
+    m_verify_blocks = true;
+    for (uint16_t i = 0; (i < m_memory_block_list.size()) && ret; i++)
+    {
+        block = &m_memory_block_list[i];
+        entry.offset += entry.length + ((i > 0) ? sizeof(MemoryBlockParams_t) : 0u);
+        entry.length = block->data_length();
+        entry.crc = MemoryCrc_crc32(block->eeprom_data(), block->data_length());
+        entry.crc = MemoryCrc_crc32(reinterpret_cast<uint8_t *>(block->bock_parameter()), sizeof(MemoryBlockParams_t), entry.crc);
+        image_crc = MemoryCrc_crc32(reinterpret_cast<uint8_t *>(&entry), sizeof(entry), image_crc);
+        ret = (i == MEMORY_HEADER_ENTRY) || block_parameter_are_valid(i);
+    }
+    m_verify_blocks = verify_blocks;
+    ret = ret && (image_crc == directory_crc);
+
+    /* Nothing has been written yet, the staged image is written and committed at once */
+    for (uint16_t i = 0; (i < m_memory_block_list.size()) && ret; i++)
+    {
+        block = &m_memory_block_list[i];
+        ret = (m_memory_interface->write(block->eeprom_data(), get_offest(i), block->data_length()) == block->data_length()) &&
+              (m_memory_interface->write(reinterpret_cast<uint8_t *>(block->bock_parameter()), get_offest(i) + block->data_length(), sizeof(MemoryBlockParams_t)) == sizeof(MemoryBlockParams_t));
+    }
+
+    if (ret == false)
+    {
+        DBIF_LOG_ERROR("Snapshot Import failed");
+
+        /* The memory holds the previous image, after a failed write of the image the written part of the new one */
+        for (uint16_t i = 0; i < m_memory_block_list.size(); i++)
+        {
+            block = &m_memory_block_list[i];
+            m_memory_interface->read(block->eeprom_data(), get_offest(i), block->data_length());
+            m_memory_interface->read(reinterpret_cast<uint8_t *>(block->bock_parameter()), get_offest(i) + block->data_length(), sizeof(MemoryBlockParams_t));
+            block->reset_block_params_update();
+        }
+        return false;
+    }
+
+#if MEMORRY_TRANSACTION_ENABLED == true
+    /* A journal of the previous image must not be replayed over the imported one */
+    m_transaction_active = false;
+    invalidate_journal();
+#endif
+
+    /* Takes over the imported image like begin() */
+    read_entry(MEMORY_HEADER_ENTRY);
+    load_verified_memory();
+    write_header(MemoryManagerStatus_e::STATUS_NOT_OK, true);
+    return write_to_memory();
+}
+
+bool MemoryManager::reset_block(uint16_t entry_idx)
+{
+    if (restore_defaults(entry_idx) == false)
+    {
+        return false;
+    }
+
+    mark_unclean();
+    return write_to_memory();
+}
+
+bool MemoryManager::reset_group(const uint16_t *entries, uint16_t count)
+{
+    bool restored = false;
+    bool ret = (entries != NULL);
+
+    /* A group with an invalid index is rejected before any block is touched */
+    for (uint16_t i = 0; (i < count) && ret; i++)
+    {
+        ret = (entries[i] != MEMORY_HEADER_ENTRY) && (entries[i] < m_memory_block_list.size());
+    }
+    if (ret == false)
+    {
+        DBIF_LOG_ERROR("Invalid Index");
+        return false;
+    }
+
+    for (uint16_t i = 0; i < count; i++)
+    {
+        if (restore_defaults(entries[i]))
+        {
+            restored = true;
+        }
+        else
+        {
+            ret = false;
+        }
+    }
+    if (restored == false)
+    {
+        return false;
+    }
+
+    /* One commit for the whole group */
+    mark_unclean();
+    return write_to_memory() && ret;
+}
+
+bool MemoryManager::append(uint16_t entry_idx, const void *record)
+{
+    MemoryManagerBlock *memory_block = ring_log(entry_idx);
+    MemoryBlockState_t *state;
+    MemoryRingRecord_t header;
+    MemoryAddress_t slot_size, slot_offset;
+    bool ret = true;
+
+    if ((memory_block == NULL) || (record == NULL) || m_transaction_active)
+    {
+        return false;
+    }
+
+    wait_io();
+    state = &m_memory_block_state_list[entry_idx];
+    slot_size = sizeof(MemoryRingRecord_t) + memory_block->record_size();
+    slot_offset = state->ring_head * slot_size;
+
+    header.seq = state->ring_seq;
+    header.crc = MemoryCrc_crc32(reinterpret_cast<uint8_t *>(&header.seq), sizeof(header.seq));
+    header.crc = MemoryCrc_crc32(reinterpret_cast<const uint8_t *>(record), memory_block->record_size(), header.crc);
+    copy_data(reinterpret_cast<uint8_t *>(&header), memory_block->user_data() + slot_offset, sizeof(header));
+    copy_data(reinterpret_cast<uint8_t *>(const_cast<void *>(record)), memory_block->user_data() + slot_offset + sizeof(header), memory_block->record_size());
+
+    if (memory_block->status() != MemoryManagerStatus_e::STATUTS_OK)
+    {
+        /* Tombstone: the data bytes in memory were never written, the first record writes the whole block */
+        write_block(entry_idx, MemoryBlockWrite_e::WRITE_ALL_BLOCKS, MemoryManagerType_e::USER_DATA, ret);
+    }
+    else
+    {
+        copy_data(memory_block->user_data() + slot_offset, memory_block->eeprom_data() + slot_offset, slot_size);
+        ret = (memory_write(entry_idx, MEMORY_IO_DATA, memory_block->eeprom_data() + slot_offset, get_offest(entry_idx) + slot_offset, slot_size) > 0);
+        state->uncommitted = true;
+    }
+
+    if (ret == false)
+    {
+        DBIF_LOG_ERROR("Entry %i: Error during append", entry_idx);
+        return false;
+    }
+
+    state->ring_head = (state->ring_head + 1u) % memory_block->record_capacity();
+    state->ring_seq++;
+    if (state->ring_count < memory_block->record_capacity())
+    {
+        state->ring_count++;
+    }
+
+    /* Committed by the next pass of loop() */
+    if (m_uncommitted == false)
+    {
+        m_uncommitted_since_ms = MemoryTimer::now_ms();
+    }
+    m_uncommitted = true;
+    m_uncommitted_bytes += slot_size;
+    return true;
+}
+
+uint16_t MemoryManager::record_count(uint16_t entry_idx)
+{
+    return (ring_log(entry_idx) != NULL) ? m_memory_block_state_list[entry_idx].ring_count : 0;
+}
+
+bool MemoryManager::read_record(uint16_t entry_idx, uint16_t n, void *record, uint32_t *seq)
+{
+    MemoryManagerBlock *memory_block = ring_log(entry_idx);
+    MemoryBlockState_t *state;
+    uint16_t capacity, slot;
+    uint32_t slot_seq;
+
+    if ((memory_block == NULL) || (record == NULL) || (n >= m_memory_block_state_list[entry_idx].ring_count))
+    {
+        return false;
+    }
+
+    state = &m_memory_block_state_list[entry_idx];
+    capacity = memory_block->record_capacity();
+    slot = (state->ring_head + capacity - state->ring_count + n) % capacity;
+    if (ring_slot_valid(memory_block, slot, slot_seq) == false)
+    {
+        DBIF_LOG_ERROR("Entry %i: Invalid Record in Slot %i", entry_idx, slot);
+        return false;
+    }
+
+    copy_data(memory_block->eeprom_data() + slot * (sizeof(MemoryRingRecord_t) + memory_block->record_size()) + sizeof(MemoryRingRecord_t),
+              reinterpret_cast<uint8_t *>(record),
+              memory_block->record_size());
+    if (seq != NULL)
     {
-        write_to_memory();
+        *seq = slot_seq;
     }
+    return true;
 }
 
 uint16_t MemoryManager::add_block(MemoryManagerBlock &new_memory_block)
 {
+    MemoryBlockState_t state = {};
+
+    if (m_memory_block_list.size() >= m_memory_block_list.max_size())
+    {
+        DBIF_LOG_ERROR("Block List full, increase MEMORRY_BLOCK_CAPACITY");
+        return 0;
+    }
+
     m_memory_block_list.push_back(new_memory_block);
     m_memory_block_param_list.push_back(new_memory_block.bock_parameter());
+    state.field_time_idx = m_field_time_list.size();
+    state.write_flag = new_memory_block.write_flag();
+    m_memory_block_state_list.push_back(state);
+    for (uint16_t i = 0; i < new_memory_block.field_count(); i++)
+    {
+        m_field_time_list.push_back(0);
+    }
+    if ((m_field_time_list.size() - state.field_time_idx) < new_memory_block.field_count())
+    {
+        /* WRITE_CYCLIC fields without a write time are written on every change */
+        DBIF_LOG_ERROR("Field Time List full, increase MEMORRY_FIELD_CAPACITY");
+    }
+    m_stats.add_block();
 
     DBIF_LOG_DEBUG_0("New Block added - Blockadr = %i",new_memory_block);
     DBIF_LOG_DEBUG_0("Memory List Block Size =  %i",m_memory_block_list.size());
@@ -111,7 +860,19 @@ void MemoryManager::remove_block(uint16_t storage_idx, bool delete_memory_data)
 
 void MemoryManager::shutdown(void)
 {
+    uint32_t start_us = MemoryStats::now_us();
+
+#if MEMORRY_TRANSACTION_ENABLED == true
+    if (m_transaction_active && (commit_transaction() == false))
+    {
+        abort_transaction();
+    }
+#endif
+
     write_all(MemoryBlockWrite_e::WRITE_ALL_BLOCKS,MemoryManagerType_e::USER_DATA);  
+    write_header(MemoryManagerStatus_e::STATUTS_OK, false);
+    write_to_memory();
+    m_stats.flushed(MemoryStats::now_us() - start_us);
 }
 
 MemoryManagerBlock *MemoryManager::get_block(uint16_t entry_idx)
@@ -120,6 +881,10 @@ MemoryManagerBlock *MemoryManager::get_block(uint16_t entry_idx)
 
     if (entry_idx < m_memory_block_list.size())
     {
+        if (is_loaded(entry_idx) == false)
+        {
+            load_block(entry_idx);
+        }
         ret = &m_memory_block_list.at(entry_idx);
     }
 
@@ -177,4 +942,188 @@ uint32_t MemoryManager::calculate_crc(MemoryManagerType_e storageType)
     // return crc.finalize();
 }
 
-#endif
\ No newline at end of file
+#endif
+#if MEMORRY_COROUTINE_ENABLED == true
+bool MemoryManager::wait_ready(MemoryManagerWait_e kind, uint16_t entry_idx, bool &result)
+{
+    bool ready = false;
+
+    if (kind == MemoryManagerWait_e::WAIT_LOAD)
+    {
+        /* Invalid blocks complete immediately */
+        ready = (entry_idx >= m_memory_block_list.size()) || is_loaded(entry_idx);
+        result = (entry_idx < m_memory_block_list.size());
+    }
+    return ready;
+}
+
+bool MemoryManager::wait(MemoryManagerWaiter_t waiter)
+{
+    MemoryBlockState_t *state;
+
+    if (m_waiter_list.size() >= m_waiter_list.max_size())
+    {
+        DBIF_LOG_ERROR("Waiter List full, increase MEMORRY_BLOCK_CAPACITY");
+        *waiter.result = false;
+        return false;
+    }
+
+    if (waiter.kind == MemoryManagerWait_e::WAIT_LOAD)
+    {
+        /* The completion of the read resumes the coroutine, a second waiter joins the running load */
+        state = &m_memory_block_state_list[waiter.entry_idx];
+        if ((state->loading == 0) && (load_async(waiter.entry_idx) == false))
+        {
+            *waiter.result = load_block(waiter.entry_idx);
+            return false;
+        }
+
+        /* Completed within read_async(), the coroutine is not suspended */
+        if (state->loading == 0)
+        {
+            *waiter.result = state->load_ok;
+            return false;
+        }
+    }
+
+    /* A pass in progress may already have checked the changed blocks */
+    waiter.pass = m_pass_count + ((m_loop_cursor == 0) ? 1u : 2u);
+    if ((waiter.kind == MemoryManagerWait_e::WAIT_SYNC) && (m_sync_pass < waiter.pass))
+    {
+        m_sync_pass = waiter.pass;
+    }
+    m_waiter_list.push_back(waiter);
+    return true;
+}
+
+void MemoryManager::resume_waiters(void)
+{
+    MemoryManagerWaiterList ready;
+    MemoryManagerWaiter_t *waiter;
+    bool done;
+
+    if ((m_io_pending > 0) || m_waiter_list.empty())
+    {
+        return;
+    }
+
+    for (uint16_t i = 0; i < m_waiter_list.size();)
+    {
+        waiter = &m_waiter_list[i];
+        done = true;
+        if (waiter->kind == MemoryManagerWait_e::WAIT_LOAD)
+        {
+            *waiter->result = is_loaded(waiter->entry_idx) || load_block(waiter->entry_idx);
+        }
+        else if (m_pass_count >= waiter->pass)
+        {
+            *waiter->result = m_pass_ok && ((waiter->kind == MemoryManagerWait_e::WAIT_FLUSH) || (m_uncommitted == false));
+        }
+        else
+        {
+            done = false;
+        }
+
+        if (done)
+        {
+            ready.push_back(*waiter);
+            m_waiter_list.erase(m_waiter_list.begin() + i);
+        }
+        else
+        {
+            i++;
+        }
+    }
+
+    /* Resumed coroutines may register new waiters */
+    for (uint16_t i = 0; i < ready.size(); i++)
+    {
+        ready[i].resume(ready[i].handle);
+    }
+}
+
+bool MemoryManager::load_async(uint16_t entry_idx)
+{
+    MemoryManagerBlock *block = &m_memory_block_list[entry_idx];
+    MemoryBlockState_t *state = &m_memory_block_state_list[entry_idx];
+    MemoryAddress_t offset = get_offest(entry_idx);
+    bool ret;
+
+    /* Counted first, backends without asynchronous transfers complete within read_async() */
+    state->loading = 2;
+    state->load_ok = true;
+    m_io_pending += 2;
+    ret = m_memory_interface->read_async(reinterpret_cast<uint8_t *>(block->bock_parameter()), offset + block->data_length(), sizeof(MemoryBlockParams_t),
+                                         &MemoryManager::load_complete, this, MEMORY_IO_PARAMETER | entry_idx);
+    if (ret == false)
+    {
+        m_io_pending -= 2;
+        state->loading = 0;
+        return false;
+    }
+
+    ret = m_memory_interface->read_async(block->eeprom_data(), offset, block->data_length(),
+                                         &MemoryManager::load_complete, this, MEMORY_IO_DATA | entry_idx);
+    if (ret == false)
+    {
+        /* The read of the parameters completes without finishing the load, the caller loads synchronously */
+        m_io_pending--;
+        wait_io();
+        state->loading = 0;
+    }
+    return ret;
+}
+
+void MemoryManager::load_complete(void *context, uint32_t tag, bool success)
+{
+    MemoryManager *manager = static_cast<MemoryManager *>(context);
+    uint16_t entry_idx = tag & 0xFFFFu;
+    MemoryManagerBlock *block = &manager->m_memory_block_list[entry_idx];
+    MemoryBlockState_t *state = &manager->m_memory_block_state_list[entry_idx];
+    MemoryManagerWaiter_t waiter;
+
+    manager->m_io_pending--;
+    state->load_ok = state->load_ok && success;
+    state->loading--;
+    if (state->loading > 0)
+    {
+        return;
+    }
+
+    /* A failed read leaves the parameters undefined, the block gets its defaults */
+    if (state->load_ok == false)
+    {
+        block->status(MemoryManagerStatus_e::STATUS_NOT_OK);
+    }
+    block->reset_block_params_update();
+    manager->copy_data(block->eeprom_data(), block->user_data(), block->data_length());
+    state->load_ok = manager->finish_load(entry_idx);
+
+    /* Resumed coroutines may register new waiters */
+    for (uint16_t i = 0; i < manager->m_waiter_list.size();)
+    {
+        if ((manager->m_waiter_list[i].kind == MemoryManagerWait_e::WAIT_LOAD) && (manager->m_waiter_list[i].entry_idx == entry_idx))
+        {
+            waiter = manager->m_waiter_list[i];
+            manager->m_waiter_list.erase(manager->m_waiter_list.begin() + i);
+            *waiter.result = state->load_ok;
+            waiter.resume(waiter.handle);
+            i = 0;
+        }
+        else
+        {
+            i++;
+        }
+    }
+}
+
+bool MemoryAwaitable::await_ready(void)
+{
+    return m_manager->wait_ready(m_kind, m_entry_idx, m_result);
+}
+
+bool MemoryAwaitable::await_suspend(std::coroutine_handle<> handle)
+{
+    return m_manager->wait(MemoryManagerWaiter_t{m_kind, m_entry_idx, 0, &MemoryAwaitable::resume, handle.address(), &m_result});
+}
+#endif
@@ -9,6 +9,9 @@
 #include "MemoryManager_Types.h"
 #include "Memory/Memory.h"
 #include "MemoryList/MemoryList.h"
+#include "MemoryStats/MemoryStats.h"
+#include "MemoryCoroutine/MemoryCoroutine.h"
+#include "MemorySnapshot/MemorySnapshot.h"
 
 /**
  * @class MemoryManager
@@ -29,6 +32,12 @@ public:
      */
     MemoryManager(Memory &interface, MemoryManagerConfig_t &config);
 
+    /**
+     * @brief The header block refers to the header buffers of this instance, a copy would share them.
+     */
+    MemoryManager(const MemoryManager &) = delete;
+    MemoryManager &operator=(const MemoryManager &) = delete;
+
     /**
      * @brief Adds a MemoryManagerConfig_t object to the storage configuration.
      * @param config A reference to a MemoryManagerConfig_t struct that specifies the configuration to add.
@@ -51,10 +60,22 @@ public:
      */
     void loop();
 
+    /**
+     * @brief Runs the main storage loop with a limited amount of work.
+     *
+     * The blocks are checked starting at the position the previous call
+     * stopped at. The header and the commit are only written once all
+     * blocks have been checked, so a commit always covers a complete pass.
+     *
+     * @param budget A MemoryManagerBudget_t limiting the time and bytes of this call.
+     */
+    void loop(const MemoryManagerBudget_t &budget);
+
     /**
      * @brief Adds a new storage entry to the data list.
      * @param new_memory_block A reference to the MemoryManagerBlock object to add_block.
-     * @return An unsigned 16-bit integer indicating the index of the new storage entry in the data list.
+     * @return An unsigned 16-bit integer indicating the index of the new storage entry in the data list,
+     *         0 if the list is full (MEMORRY_BLOCK_CAPACITY).
      */
     uint16_t add_block(MemoryManagerBlock &new_memory_block);
 
@@ -82,18 +103,333 @@ public:
      */
     MemoryManagerBlock *get_block(uint16_t entry_idx);
 
+    /**
+     * @brief Retrieves the user data of a block based on the given entry index.
+     *
+     * In the LOAD_ON_DEMAND modes the block is read from memory on its first access.
+     *
+     * @tparam T The data type of the memory block.
+     * @param entry_idx An unsigned 16-bit integer specifying the index of the storage entry.
+     * @return A pointer to the user data or nullptr if the index is invalid.
+     */
+    template <typename T = uint8_t>
+    T *get_block_data(uint16_t entry_idx)
+    {
+        return get_data<T>(get_block(entry_idx), MemoryManagerType_e::USER_DATA);
+    }
+
+    /**
+     * @brief Copies a value into the user data of a block and reports the change.
+     * @tparam T The data type of the memory block, its size has to match the block.
+     * @param entry_idx An unsigned 16-bit integer specifying the index of the storage entry.
+     * @param value The new value.
+     * @return False if the index or the size does not match.
+     */
+    template <typename T>
+    bool set_block_data(uint16_t entry_idx, const T &value)
+    {
+        T *data = get_block_data<T>(entry_idx);
+        bool ret = (data != nullptr) && (sizeof(T) == get_block(entry_idx)->data_length());
+
+        if (ret)
+        {
+            *data = value;
+            block_changed(entry_idx);
+        }
+        return ret;
+    }
+
+    /**
+     * @brief Reports a change of the user data of a block.
+     *
+     * Publishes EVENT_BLOCK_CHANGED and schedules the next pass of loop(),
+     * required for blocks changed directly with change_driven enabled.
+     *
+     * @param entry_idx An unsigned 16-bit integer specifying the index of the storage entry.
+     */
+    void block_changed(uint16_t entry_idx);
+
+    /**
+     * @brief Subscribes to events of this manager.
+     * @param mask MEMORY_EVENT_MASK() of the events, MEMORY_EVENT_MASK_ALL for all.
+     * @param callback Function invoked for each event.
+     * @param context Passed to the callback.
+     * @return False if no further subscriber can be added.
+     */
+    bool subscribe(uint32_t mask, MemoryManagerEventCallback_t callback, void *context = nullptr);
+
+    /**
+     * @brief Removes a subscription.
+     * @param callback The callback passed to subscribe().
+     * @param context The context passed to subscribe().
+     */
+    void unsubscribe(MemoryManagerEventCallback_t callback, void *context = nullptr);
+
+#if MEMORRY_TRANSACTION_ENABLED == true
+    /**
+     * @brief Starts a transaction, loop() does not write any block until it is finished.
+     *
+     * The blocks reported by set_block_data() or block_changed() until
+     * commit_transaction() become durable together, other changes are
+     * written by loop() after the transaction.
+     *
+     * @return False if a transaction is already open or the memory has no room for the journal.
+     */
+    bool begin_transaction(void);
+
+    /**
+     * @brief Makes the changes of the open transaction durable all-or-nothing.
+     *
+     * The new data of the changed member blocks is written to the journal and
+     * committed, then the blocks are written in place. They are committed
+     * by the next commit of loop() or shutdown(), until then begin() replays
+     * the journal after a power loss.
+     *
+     * @return False if the journal could not be written, the transaction stays open then.
+     */
+    bool commit_transaction(void);
+
+    /**
+     * @brief Discards the changes of the open transaction, the user data of its blocks is restored from the memory mirror.
+     */
+    void abort_transaction(void);
+#endif
+
+    /**
+     * @brief Writes a snapshot of the memory image (header, block directory, chunks with CRCs).
+     *
+     * The snapshot is taken from the memory mirror, changes not yet written
+     * by loop() are not part of it. Only one chunk is buffered.
+     *
+     * @param sink Receives the snapshot.
+     * @return False if the sink failed.
+     */
+    bool export_snapshot(MemorySnapshotSink &sink);
+
+    /**
+     * @brief Replaces the memory image by a snapshot and reloads the blocks.
+     *
+     * The snapshot has to match the version and block layout. The chunks are
+     * staged in the memory mirrors of the blocks. Only after the CRCs of all
+     * chunks, of the whole image and of every directory entry, and the block
+     * parameters are verified, the image is written and committed once. If
+     * the import fails the mirrors are read back from memory, which has not
+     * been written. The user data is not touched then.
+     *
+     * @param source Provides the snapshot.
+     * @return False if the snapshot is invalid or does not match, nothing is written then.
+     */
+    bool import_snapshot(MemorySnapshotSource &source);
+
+    /**
+     * @brief Restores the default data of a block and commits it.
+     *
+     * Only a block which differs from its defaults in memory is written. With
+     * MEMORRY_LAZY_DEFAULTS_ENABLED only its parameter is written, marked STATUS_DEFAULT.
+     *
+     * @param entry_idx An unsigned 16-bit integer specifying the index of the storage entry.
+     * @return False if the index is invalid or the write failed.
+     */
+    bool reset_block(uint16_t entry_idx);
+
+    /**
+     * @brief Restores the default data of several blocks with a single commit.
+     * @param entries The indices of the blocks.
+     * @param count The number of indices.
+     * @return False if an index is invalid (nothing is reset then) or a write failed.
+     */
+    bool reset_group(const uint16_t *entries, uint16_t count);
+
+    /**
+     * @brief Appends a record to a ring log block, overwriting the oldest one if the log is full.
+     *
+     * Only the slot of the record is written, the commit follows with the
+     * next pass of loop() (commit_policy) or shutdown().
+     *
+     * @param entry_idx Index of a block configured with record_size().
+     * @param record Record of record_size() bytes.
+     * @return False if the block is no ring log or the write failed.
+     */
+    bool append(uint16_t entry_idx, const void *record);
+
+    /**
+     * @brief Returns the number of records in a ring log block, at most record_capacity().
+     * @param entry_idx Index of a block configured with record_size().
+     */
+    uint16_t record_count(uint16_t entry_idx);
+
+    /**
+     * @brief Reads a record of a ring log block.
+     * @param entry_idx Index of a block configured with record_size().
+     * @param n Position of the record, 0 is the oldest, record_count() - 1 the newest.
+     * @param record Buffer of record_size() bytes.
+     * @param seq Optional, receives the sequence number of the record.
+     * @return False if there is no such record or its CRC is invalid.
+     */
+    bool read_record(uint16_t entry_idx, uint16_t n, void *record, uint32_t *seq = NULL);
+
+    /**
+     * @brief Returns the size of the memory image of the configured blocks in bytes.
+     */
+    MemoryAddress_t image_size(void) { return get_offest(m_memory_block_list.size()); }
+
+    /**
+     * @brief Returns the size of a factory image in bytes, the image followed by its MemoryFactoryImageTrailer_t.
+     */
+    MemoryAddress_t factory_image_size(void) { return image_size() + sizeof(MemoryFactoryImageTrailer_t); }
+
+    /**
+     * @brief Returns the size the memory has to provide: the image and, with transactions, the journal behind it.
+     */
+#if MEMORRY_TRANSACTION_ENABLED == true
+    MemoryAddress_t required_size(void) { return image_size() + MEMORRY_JOURNAL_SIZE; }
+#else
+    MemoryAddress_t required_size(void) { return image_size(); }
+#endif
+
+    /**
+     * @brief Builds the default image: header, default data and parameters of all blocks.
+     *
+     * The header is marked as cleanly shut down, so a pre-flashed image is
+     * loaded without verification. Can be called from a host build of the
+     * block configuration to generate images at build time. The image is
+     * followed by a MemoryFactoryImageTrailer_t with the layout hash and the
+     * CRC of the image, the first image_size() bytes are pre-flashed.
+     *
+     * @param buffer Receives the image and the trailer.
+     * @param size Size of the buffer, at least factory_image_size().
+     * @return The size of the image incl. the trailer, 0 if the buffer is too small.
+     */
+    MemoryAddress_t factory_image(uint8_t *buffer, MemoryAddress_t size);
+
     /**
      * @brief Shuts down the MemoryManager and releases any resources.
      */
     void shutdown(void);
 
+    /**
+     * @brief Returns the write frequency class of a block.
+     * @param entry_idx An unsigned 16-bit integer specifying the index of the storage entry.
+     * @return BLOCK_HOT if the block is written frequently, otherwise BLOCK_COLD.
+     */
+    MemoryBlockTemperature_e block_temperature(uint16_t entry_idx);
+
+    /**
+     * @brief Returns a snapshot of the global performance counters.
+     * @return A copy of the counters, all zero if MEMORRY_STATS_ENABLED is false.
+     */
+    MemoryManagerStats_t stats(void) const { return m_stats.snapshot(); }
+
+    /**
+     * @brief Returns a snapshot of the performance counters of a block.
+     * @param entry_idx An unsigned 16-bit integer specifying the index of the storage entry.
+     * @return A copy of the counters, all zero for an invalid index.
+     */
+    MemoryBlockStats_t block_stats(uint16_t entry_idx) const { return m_stats.block_snapshot(entry_idx); }
+
+    /**
+     * @brief Resets all performance counters.
+     */
+    void reset_stats(void) { m_stats.reset(); }
+
+#if MEMORRY_COROUTINE_ENABLED == true
+    /**
+     * @brief Awaits the next complete pass of loop(), all changes are written to memory.
+     * @return An awaitable yielding true if all writes were successful.
+     */
+    MemoryAwaitable flush(void) { return MemoryAwaitable(this, WAIT_FLUSH, 0); }
+
+    /**
+     * @brief Awaits the next complete pass of loop() including the commit.
+     *
+     * Deferred changes of hot blocks and the commit policy are overridden
+     * for this pass.
+     *
+     * @return An awaitable yielding true if all changes are committed.
+     */
+    MemoryAwaitable sync(void) { return MemoryAwaitable(this, WAIT_SYNC, 0); }
+
+    /**
+     * @brief Awaits the block being read from memory (LOAD_ON_DEMAND modes).
+     *
+     * The block is read with Memory::read_async(), the completion of the
+     * read resumes the coroutine. Reads which complete within read_async()
+     * do not suspend it.
+     *
+     * @param entry_idx An unsigned 16-bit integer specifying the index of the storage entry.
+     * @return An awaitable yielding true if the block parameters are valid.
+     */
+    MemoryAwaitable load(uint16_t entry_idx) { return MemoryAwaitable(this, WAIT_LOAD, entry_idx); }
+
+    /**
+     * @brief Checks whether a condition is already met, used by MemoryAwaitable.
+     * @param kind The awaited condition.
+     * @param entry_idx The block of WAIT_LOAD.
+     * @param result Receives the result if the condition is met.
+     * @return True if the coroutine does not have to be suspended.
+     */
+    bool wait_ready(MemoryManagerWait_e kind, uint16_t entry_idx, bool &result);
+
+    /**
+     * @brief Registers a suspended coroutine, used by MemoryAwaitable.
+     * @param waiter The coroutine and its condition.
+     * @return False if the waiter list is full, the coroutine is not suspended then and gets a false result.
+     */
+    bool wait(MemoryManagerWaiter_t waiter);
+#endif
+
 protected:
+    /**
+     * @brief Adds the block of the header buffers of this instance as MEMORY_HEADER_ENTRY.
+     */
+    void add_header_block(void);
+
     /**
      * @brief Reads all storage entries in the data list.
      * @return A boolean value indicating the success of the operation.
      */
     bool read_all(void);
 
+#if MEMORRY_BULK_READ_ENABLED == true
+    /**
+     * @brief Reads all blocks with a single Memory::read() into a staging buffer
+     *        and distributes the data and parameters to the blocks.
+     * @param read_all_blocks_valid Set to false if a block parameter is invalid.
+     * @return False if the staging buffer could not be provided, nothing has been read then.
+     */
+    bool read_all_bulk(bool &read_all_blocks_valid);
+#endif
+
+    /**
+     * @brief Reads the parameters and data of a block which has not been loaded yet.
+     * @param entry_idx An unsigned 16-bit integer specifying the index of the storage entry.
+     * @return A boolean value indicating whether the block parameters are valid.
+     */
+    bool load_block(uint16_t entry_idx);
+
+    /**
+     * @brief Completes the load of a block whose parameters and memory mirror have been read.
+     *
+     * Replaces the data of a tombstone by its defaults, marks the block as
+     * loaded, publishes the result and repairs invalid blocks.
+     *
+     * @param entry_idx An unsigned 16-bit integer specifying the index of the storage entry.
+     * @return A boolean value indicating whether the block parameters are valid.
+     */
+    bool finish_load(uint16_t entry_idx);
+
+    /**
+     * @brief Checks whether the data of a block has been read from memory.
+     * @param entry_idx An unsigned 16-bit integer specifying the index of the storage entry.
+     * @return True if the block is loaded or all blocks are loaded during begin().
+     */
+    bool is_loaded(uint16_t entry_idx);
+
+    /**
+     * @brief Loads the next block which has not been accessed yet (LOAD_ON_DEMAND_PREFETCH).
+     */
+    void prefetch(void);
+
     /**
      * @brief Reads a specific storage entry from the data list.
      * @param entry_idx An unsigned 16-bit integer specifying the index of the storage entry.
@@ -108,12 +444,54 @@ protected:
 
     /**
      * @brief Writes all storage entries to the storage interface.
+     *
+     * The entries are written in flush order, written user data of the
+     * critical class is committed before the other classes are written.
+     *
      * @param write_flag A MemoryBlockWrite_e value specifying the write flag.
      * @param type A MemoryManagerType_e value specifying the data type.
      * @return A boolean value indicating the success of the operation.
      */
     bool write_all(MemoryBlockWrite_e write_flag = WRITE_ALL_BLOCKS, MemoryManagerType_e type = MemoryManagerType_e::USER_DATA);
 
+    /**
+     * @brief Fills a list with the block indices in flush order.
+     *
+     * Blocks are ordered by their priority class, blocks of the same class
+     * keep their index order. The header entry is not part of the list.
+     *
+     * @param order The list to fill.
+     */
+    void flush_order(MemoryManagerBlockOrder &order);
+
+    /**
+     * @brief Writes a block if it matches the write flag and differs from the memory mirror.
+     * @param entry_idx An unsigned 16-bit integer specifying the index of the storage entry.
+     * @param write_flag A MemoryBlockWrite_e value specifying the write flag.
+     * @param type A MemoryManagerType_e value specifying the data type.
+     * @param write_success Set to the result of the write, untouched if nothing was written.
+     * @return The number of bytes written (data and parameter).
+     */
+    uint32_t write_block(uint16_t entry_idx, MemoryBlockWrite_e write_flag, MemoryManagerType_e type, bool &write_success);
+
+    /**
+     * @brief Writes the changed fields of a block with a field layout whose write policy is due.
+     * @param entry_idx An unsigned 16-bit integer specifying the index of the storage entry.
+     * @param write_flag WRITE_ON_CHANGE from loop(), WRITE_ALL_BLOCKS writes every changed field.
+     * @param write_success Set to false if a write failed, untouched if nothing was written.
+     * @return The number of bytes written.
+     */
+    uint32_t write_fields(uint16_t entry_idx, MemoryBlockWrite_e write_flag, bool &write_success);
+
+    /**
+     * @brief Writes the data and the parameters of a block as a whole.
+     * @param entry_idx An unsigned 16-bit integer specifying the index of the storage entry.
+     * @param type The data written (user or default data).
+     * @param write_success Set to false if a write failed.
+     * @return The number of bytes written.
+     */
+    uint32_t write_whole_block(uint16_t entry_idx, MemoryManagerType_e type, bool &write_success);
+
     /**
      * @brief Writes the parameters of a specific storage entry to the storage interface.
      * @param entry_idx An unsigned 16-bit integer specifying the index of the storage entry.
@@ -129,12 +507,141 @@ protected:
      */
     bool write_entry(uint16_t entry_idx, MemoryManagerType_e data_type = MemoryManagerType_e::USER_DATA);
 
+    /**
+     * @brief Writes block data or parameters to the memory interface.
+     *
+     * While loop() flushes asynchronously the write is only issued, the
+     * result is reported to io_complete().
+     *
+     * @param entry_idx An unsigned 16-bit integer specifying the index of the storage entry.
+     * @param io_type MEMORY_IO_DATA or MEMORY_IO_PARAMETER.
+     * @param data_ptr The data to write, has to stay valid until the write completed.
+     * @param offset The offset in memory.
+     * @param len The number of bytes.
+     * @return The number of bytes written (or issued).
+     */
+    MemoryAddress_t memory_write(uint16_t entry_idx, uint32_t io_type, uint8_t *data_ptr, MemoryAddress_t offset, MemoryAddress_t len);
+
+    /**
+     * @brief Updates the commit state after a commit has finished.
+     * @param success The result of the commit.
+     * @param duration_us The duration of the commit.
+     */
+    void commit_complete(bool success, uint32_t duration_us);
+
+#if MEMORRY_ASYNC_ENABLED == true
+    /**
+     * @brief Completion callback of the asynchronous memory requests.
+     * @param context The MemoryManager which issued the request.
+     * @param tag Request type and block index.
+     * @param success The result of the request.
+     */
+    static void io_complete(void *context, uint32_t tag, bool success);
+#endif
+
+    /**
+     * @brief Invokes the subscribers of an event.
+     * @param event The event.
+     * @param entry_idx The block the event refers to.
+     */
+    void publish(MemoryManagerEvent_e event, uint16_t entry_idx);
+
+    /**
+     * @brief Checks whether loop() has any work with change_driven enabled.
+     * @return True if a pass is required.
+     */
+    bool work_pending(void);
+
+#if MEMORRY_TRANSACTION_ENABLED == true
+    /**
+     * @brief Calculates the byte offset of the transaction journal behind the last block.
+     * @return The offset in bytes.
+     */
+    MemoryAddress_t journal_offset(void);
+
+    /**
+     * @brief Applies a journal left by an interrupted transaction.
+     * @return True if a journal has been replayed.
+     */
+    bool replay_journal(void);
+
+    /**
+     * @brief Marks the journal as applied, takes effect with the next commit.
+     * @return A boolean value indicating the success of the operation.
+     */
+    bool invalidate_journal(void);
+#endif
+
+    /**
+     * @brief Waits until all asynchronous memory requests have completed.
+     *
+     * Polls the memory and yields in between, at most MEMORRY_IO_TIMEOUT_MS.
+     *
+     * @return False if requests are still outstanding after the timeout.
+     */
+    bool wait_io(void);
+
+#if MEMORRY_COROUTINE_ENABLED == true
+    /**
+     * @brief Resumes the coroutines whose condition is met.
+     *
+     * Called by loop() while no asynchronous memory request is outstanding.
+     */
+    void resume_waiters(void);
+
+    /**
+     * @brief Issues the reads of parameters and data of a block with Memory::read_async().
+     * @param entry_idx An unsigned 16-bit integer specifying the index of the storage entry.
+     * @return False if the reads could not be issued, nothing is outstanding then.
+     */
+    bool load_async(uint16_t entry_idx);
+
+    /**
+     * @brief Completion callback of the reads of load_async(), the last one completes the load and resumes the waiting coroutines.
+     * @param context The MemoryManager which issued the request.
+     * @param tag Request type and block index.
+     * @param success The result of the request.
+     */
+    static void load_complete(void *context, uint32_t tag, bool success);
+#endif
+
     /**
      * @brief Writes data to the storage interface.
      * @return A boolean value indicating the success of the operation.
      */
     bool write_to_memory(void);
 
+    /**
+     * @brief Updates the write rate of a changed block and decides whether its write is deferred.
+     *
+     * Called with a block the caller has already found dirty, a change is
+     * counted when the block becomes dirty and for each change reported by
+     * block_changed() while it is deferred.
+     *
+     * @param entry_idx An unsigned 16-bit integer specifying the index of the storage entry.
+     * @return True if the block is hot and the change can still wait.
+     */
+    bool defer_write(uint16_t entry_idx);
+
+    /**
+     * @brief Applies the decay of the write rate up to now and updates the classification.
+     * @param entry_idx An unsigned 16-bit integer specifying the index of the storage entry.
+     * @param now_ms The current time in milliseconds.
+     */
+    void decay_write_rate(uint16_t entry_idx, uint32_t now_ms);
+
+    /**
+     * @brief Passes the range and temperature of a block to the memory interface as placement hint.
+     * @param entry_idx An unsigned 16-bit integer specifying the index of the storage entry.
+     */
+    void place_block(uint16_t entry_idx);
+
+    /**
+     * @brief Checks the commit policy whether uncommitted data has to be committed now.
+     * @return True if a commit is due.
+     */
+    bool commit_due(void);
+
     /**
      * @brief Deletes a specific storage entry from the data list.
      * @param entry_idx An unsigned 16-bit integer specifying the index of the storage entry.
@@ -144,17 +651,159 @@ protected:
 
     /**
      * @brief Checks if the block parameters of a specific storage entry are valid.
+     *
+     * Status and write flag have to be in range and the CRC of the parameters
+     * has to match the block read from memory.
+     *
      * @param entry_idx An unsigned 16-bit integer specifying the index of the storage entry.
      * @return A boolean value indicating whether the block parameters are valid.
      */
     bool block_parameter_are_valid(uint16_t entry_idx);
 
+    /**
+     * @brief Calculates the CRC stored in the block parameters.
+     *
+     * Covers the data and the parameters before the CRC. Tombstones of lazy
+     * defaults and ring logs are covered by their parameters only.
+     *
+     * @param memory_block Block the parameters belong to.
+     * @param params Parameters to be written.
+     * @param data Data to be written.
+     * @return CRC32 of the block.
+     */
+    uint32_t block_crc(MemoryManagerBlock *memory_block, const MemoryBlockParams_t &params, const uint8_t *data);
+
+    /**
+     * @brief Replaces a block with invalid parameters by its defaults and the configured parameters.
+     * @param entry_idx An unsigned 16-bit integer specifying the index of the storage entry.
+     */
+    void repair_block(uint16_t entry_idx);
+
     /**
      * @brief Verifies the integrity of the storage.
      * @return A MemoryManagerStatus_e value indicating the status of the memory verification.
      */
     MemoryManagerStatus_e verify_memory(void);
 
+    /**
+     * @brief Checks whether a block of the image passes its CRC, used if the header itself is torn.
+     * @return True if the image has the current layout.
+     */
+    bool image_has_valid_block(void);
+
+    /**
+     * @brief Moves the blocks of an image written by an older library version to the current layout.
+     *
+     * The blocks are moved from the last to the first, each to a higher
+     * offset, so blocks not moved yet stay intact. A block which already
+     * passes its CRC at the new offset was moved by an interrupted migration.
+     *
+     * @param header_length Size of the header data in the old layout.
+     * @return A boolean value indicating the success of the operation.
+     */
+    bool migrate_image(MemoryAddress_t header_length);
+
+    /**
+     * @brief Copies a part of a memory image into the memory mirrors and parameters of the blocks.
+     * @param data Part of the image.
+     * @param offset Offset of the part in the image.
+     * @param len Length of the part.
+     */
+    void stage_image(const uint8_t *data, MemoryAddress_t offset, MemoryAddress_t len);
+
+    /**
+     * @brief Returns a CRC32 over the layout of the image: header and parameter size and size, write flag and record size of each block.
+     */
+    uint32_t layout_hash(void);
+
+#if MEMORRY_FACTORY_IMAGE_ENABLED == true
+    /**
+     * @brief Writes the default image with a single Memory::write() and commits it.
+     *
+     * Uses the configured factory image if it matches the blocks and the
+     * version, otherwise builds it in a staging buffer.
+     *
+     * @return False if the image could not be provided or written, nothing has been written then.
+     */
+    bool write_factory_image(void);
+
+    /**
+     * @brief Checks the trailer of a factory image: layout hash, image CRC and version.
+     * @param image Image followed by its trailer.
+     * @param size Size of the image incl. the trailer.
+     * @return True if the image was built for this configuration and is intact.
+     */
+    bool factory_image_valid(const uint8_t *image, MemoryAddress_t size);
+#endif
+
+    /**
+     * @brief Copies the default data of a block into its user data and memory mirror without writing it.
+     * @param entry_idx An unsigned 16-bit integer specifying the index of the storage entry.
+     */
+    void load_defaults(uint16_t entry_idx);
+
+    /**
+     * @brief Restores the default data of a block and writes it (or its STATUS_DEFAULT parameter).
+     * @param entry_idx An unsigned 16-bit integer specifying the index of the storage entry.
+     * @return False if the index is invalid or the write failed.
+     */
+    bool restore_defaults(uint16_t entry_idx);
+
+#if MEMORRY_LAZY_DEFAULTS_ENABLED == true
+    /**
+     * @brief Marks all blocks STATUS_DEFAULT and writes their parameters only, used instead of the default data.
+     * @return A boolean value indicating the success of the operation.
+     */
+    bool write_lazy_defaults(void);
+#endif
+
+    /**
+     * @brief Writes the header as not cleanly shut down if data changes after shutdown().
+     */
+    void mark_unclean(void);
+
+    /**
+     * @brief Returns a ring log block, locating its head first if the block was (re)loaded.
+     * @param entry_idx An unsigned 16-bit integer specifying the index of the storage entry.
+     * @return The block or NULL if the index is invalid or the block is no ring log.
+     */
+    MemoryManagerBlock *ring_log(uint16_t entry_idx);
+
+    /**
+     * @brief Locates head and size of a ring log by a binary search over the sequence numbers.
+     * @param entry_idx An unsigned 16-bit integer specifying the index of the storage entry.
+     */
+    void ring_recover(uint16_t entry_idx);
+
+    /**
+     * @brief Checks sequence number and CRC of a record slot of a ring log.
+     * @param block The ring log block.
+     * @param slot Index of the slot.
+     * @param seq Receives the sequence number, 0 if the slot is empty or invalid.
+     * @return True if the slot holds a valid record.
+     */
+    bool ring_slot_valid(MemoryManagerBlock *block, uint16_t slot, uint32_t &seq);
+
+    /**
+     * @brief Checks whether the header is intact and was written by a clean shutdown().
+     * @return True if the full verification can be skipped.
+     */
+    bool header_is_clean(void);
+
+    /**
+     * @brief Loads the blocks of an image known to be valid, without verification.
+     * @return A MemoryManagerStatus_e value indicating the status of the memory.
+     */
+    MemoryManagerStatus_e load_verified_memory(void);
+
+    /**
+     * @brief Updates the shutdown marker and the CRC of the header and writes it.
+     * @param shutdown STATUTS_OK to mark a clean shutdown, STATUS_NOT_OK while running.
+     * @param new_generation True to increment the image generation.
+     * @return A boolean value indicating the success of the operation.
+     */
+    bool write_header(MemoryManagerStatus_e shutdown, bool new_generation);
+
     /**
      * @brief Sets the memory verification status.
      * @param status A MemoryManagerStatus_e value specifying the memory verification status.
@@ -170,9 +819,9 @@ protected:
     /**
      * @brief Calculates the byte offset value of a storage index.
      * @param idx An unsigned 16-bit integer specifying the MemoryManager index.
-     * @return An unsigned 16-bit integer indicating the offset in bytes.
+     * @return The offset in bytes.
      */
-    uint16_t get_offest(uint16_t idx);
+    MemoryAddress_t get_offest(uint16_t idx);
 
     /**
      * @brief Copies data from source to destination.
@@ -180,7 +829,7 @@ protected:
      * @param destination The target where the data will be copied.
      * @param size The size of the data to be copied.
      */
-    void copy_data(uint8_t *source, uint8_t *destination, int16_t size);
+    void copy_data(uint8_t *source, uint8_t *destination, MemoryAddress_t size);
 
     /**
      * @brief Compares two blocks of data.
@@ -189,7 +838,7 @@ protected:
      * @param size The size of the data blocks to compare.
      * @return A MemoryDataCompare_e value indicating the result of the data comparison.
      */
-    MemoryDataCompare_e compare_data(uint8_t *source_1, uint8_t *source_2, int16_t size);
+    MemoryDataCompare_e compare_data(uint8_t *source_1, uint8_t *source_2, MemoryAddress_t size);
 
     /**
      * @brief Compares a specific storage entry with data of a given type.
@@ -238,6 +887,42 @@ private:
     Memory *m_memory_interface;                 /**< A pointer to the storage interface. */
     MemoryManagerVersion_t m_current_version;
     MemoryManagerBlockParamList m_memory_block_param_list;
+    MemoryManagerBlockStateList m_memory_block_state_list;   /**< Runtime state of each block. */
+    MemoryManagerLoad_e m_load_mode;                          /**< Strategy to load the blocks from memory. */
+    uint16_t m_prefetch_idx;                                  /**< Next block to check for prefetching. */
+    MemoryStats m_stats;                                      /**< Performance counters. */
+    MemoryManagerBlockOrder m_flush_order;                    /**< Block order of the current pass of loop(). */
+    uint16_t m_loop_cursor;                                   /**< Position in m_flush_order checked next by loop(). */
+    bool m_loop_written;                                      /**< A block has been written in the current pass of loop(). */
+    MemoryManagerCommitPolicy_t m_commit_policy;              /**< When loop() commits written blocks. */
+    bool m_uncommitted;                                       /**< Blocks have been written but not committed. */
+    uint32_t m_uncommitted_bytes;                             /**< Bytes written since the last commit. */
+    uint32_t m_uncommitted_since_ms;                          /**< Time of the first write since the last commit. */
+    uint32_t m_last_commit_ms;                                /**< Time of the last commit. */
+    MemoryManagerHeatPolicy_t m_heat_policy;                  /**< Hot/cold classification of blocks. */
+    bool m_cold_written;                                      /**< A cold block has been written since the last commit. */
+    bool m_io_async;                                          /**< Memory requests are issued asynchronously (flush of loop()). */
+    uint16_t m_io_pending;                                    /**< Number of outstanding asynchronous memory requests. */
+    uint32_t m_io_flush_start_us;                             /**< Start of the asynchronous flush. */
+    uint32_t m_io_commit_start_us;                            /**< Start of the asynchronous commit. */
+    MemoryManagerIoList m_io_length;                          /**< Lengths of the outstanding asynchronous writes, in issue order. */
+    MemoryManagerFieldTimeList m_field_time_list;             /**< Time each field was last written, for WRITE_CYCLIC fields. */
+    MemoryManagerWaiterList m_waiter_list;                    /**< Coroutines suspended on flush(), sync() or load(). */
+    uint32_t m_pass_count;                                    /**< Number of completed loop() passes. */
+    uint32_t m_sync_pass;                                     /**< Last pass which has to commit for a sync(). */
+    bool m_sync_active;                                       /**< The current pass was requested by sync(). */
+    bool m_pass_ok;                                           /**< All writes of the current pass were successful. */
+    MemoryManagerSubscriberList m_subscriber_list;            /**< Subscribers of the events. */
+    bool m_change_driven;                                     /**< loop() only works after block_changed(). */
+    bool m_change_pending;                                    /**< A change was reported or a change is deferred. */
+    bool m_transaction_active;                                /**< loop() is paused by begin_transaction(). */
+    bool m_verify_blocks;                                     /**< Loaded blocks are checked against their CRC, not after a clean shutdown(). */
+    bool m_size_valid;                                        /**< The memory holds required_size() bytes, checked by begin(). */
+    const uint8_t *m_factory_image;                           /**< Default image generated at build time. */
+    MemoryAddress_t m_factory_image_size;                     /**< Size of the factory image. */
+    MemoryManagerHeader_t m_header;                           /**< User data of the header block. */
+    MemoryManagerHeader_t m_memory_header;                    /**< Memory mirror of the header block. */
+    MemoryManagerHeader_t m_default_header;                   /**< Default data of the header block. */
 };
 
 #endif /* MEMORY_MANAGER_H */
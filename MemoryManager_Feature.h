@@ -9,6 +9,91 @@
     #define MEMORRY_TIMER_ENABLED                           false
 #endif
 
+/* Performance counters, see MemoryManager::stats() */
+#ifndef MEMORRY_STATS_ENABLED
+    #define MEMORRY_STATS_ENABLED                           true
+#endif
+
+/* Binary trace events of the hot paths, see MemoryTrace/MemoryTrace.h */
+#ifndef MEMORRY_TRACE_ENABLED
+    #define MEMORRY_TRACE_ENABLED                           false
+#endif
+
+/* Number of trace events kept in the ring buffer, must be a power of two */
+#ifndef MEMORRY_TRACE_BUFFER_SIZE
+    #define MEMORRY_TRACE_BUFFER_SIZE                       256u
+#endif
+
+/* loop() flushes through the asynchronous Memory interface without blocking */
+#ifndef MEMORRY_ASYNC_ENABLED
+    #define MEMORRY_ASYNC_ENABLED                           false
+#endif
+
+/* co_await flush()/sync()/load() awaitables, requires C++20 coroutines */
+#ifndef MEMORRY_COROUTINE_ENABLED
+    #define MEMORRY_COROUTINE_ENABLED                       false
+#endif
+
+/* Maximum number of blocks per manager, 0: the block lists grow on the heap */
+#ifndef MEMORRY_BLOCK_CAPACITY
+    #define MEMORRY_BLOCK_CAPACITY                          0u
+#endif
+
+/* Maximum number of event subscribers with MEMORRY_BLOCK_CAPACITY */
+#ifndef MEMORRY_SUBSCRIBER_CAPACITY
+    #define MEMORRY_SUBSCRIBER_CAPACITY                     4u
+#endif
+
+/* Maximum number of outstanding asynchronous writes with MEMORRY_BLOCK_CAPACITY, further writes wait for completions */
+#ifndef MEMORRY_IO_CAPACITY
+    #define MEMORRY_IO_CAPACITY                             32u
+#endif
+
+/* Time (ms) a synchronous call waits for outstanding asynchronous requests before it gives up */
+#ifndef MEMORRY_IO_TIMEOUT_MS
+    #define MEMORRY_IO_TIMEOUT_MS                           1000u
+#endif
+
+/* Maximum number of field descriptors of all blocks with MEMORRY_BLOCK_CAPACITY */
+#ifndef MEMORRY_FIELD_CAPACITY
+    #define MEMORRY_FIELD_CAPACITY                          32u
+#endif
+
+/* begin_transaction()/commit_transaction(), the journal is stored behind the last block */
+#ifndef MEMORRY_TRANSACTION_ENABLED
+    #define MEMORRY_TRANSACTION_ENABLED                     false
+#endif
+
+/* Size (bytes) reserved for the transaction journal, limits the blocks of one transaction */
+#ifndef MEMORRY_JOURNAL_SIZE
+    #define MEMORRY_JOURNAL_SIZE                            512u
+#endif
+
+/* Payload of one snapshot chunk, export_snapshot()/import_snapshot() buffer one chunk */
+#ifndef MEMORRY_SNAPSHOT_CHUNK_SIZE
+    #define MEMORRY_SNAPSHOT_CHUNK_SIZE                     256u
+#endif
+
+/* Read the whole image with one Memory::read() during begin() */
+#ifndef MEMORRY_BULK_READ_ENABLED
+    #define MEMORRY_BULK_READ_ENABLED                       true
+#endif
+
+/* First boot and version bumps write the complete default image with one Memory::write() */
+#ifndef MEMORRY_FACTORY_IMAGE_ENABLED
+    #define MEMORRY_FACTORY_IMAGE_ENABLED                   true
+#endif
+
+/* Blocks at their defaults are stored as STATUS_DEFAULT parameter only, the data comes from default_data */
+#ifndef MEMORRY_LAZY_DEFAULTS_ENABLED
+    #define MEMORRY_LAZY_DEFAULTS_ENABLED                   false
+#endif
+
+/* Largest image (bytes) staged in RAM for the bulk read or the factory image */
+#ifndef MEMORRY_BULK_READ_MAX_SIZE
+    #define MEMORRY_BULK_READ_MAX_SIZE                      4096u
+#endif
+
 
 
 
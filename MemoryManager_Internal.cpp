@@ -1,51 +1,188 @@
+#include <new>
+#include <stddef.h>
 #include "MemoryManager.h"
 #include "MemoryManager_Debug.h"
+#include "MemoryCrc/MemoryCrc.h"
+#include "MemoryTrace/MemoryTrace.h"
 
 bool MemoryManager::read_all(void)
 {
     bool read_all_blocks_valid = true;
-    MemoryManagerBlock *memory_block;
+
+#if MEMORRY_BULK_READ_ENABLED == true
+    if (read_all_bulk(read_all_blocks_valid))
+    {
+        return read_all_blocks_valid;
+    }
+#endif
 
     for (uint16_t i = 1; i < m_memory_block_list.size(); i++)
     {
-        read_block_parameter(i); 
-        read_entry(i);            
+        if(load_block(i) == false)
+        {
+            read_all_blocks_valid = false;
+        }
+    }
+    return read_all_blocks_valid;
+}
+
+#if MEMORRY_BULK_READ_ENABLED == true
+bool MemoryManager::read_all_bulk(bool &read_all_blocks_valid)
+{
+    MemoryAddress_t start = 0, size = 0;
+    MemoryAddress_t offset = 0;
+    uint8_t *staging = NULL;
+    MemoryManagerBlock *memory_block;
+    bool ret = false;
+
+    if (m_memory_block_list.size() <= 1)
+    {
+        ret = true;
+    }
+    else
+    {
+        start = get_offest(1);
+        for (uint16_t i = 1; i < m_memory_block_list.size(); i++)
+        {
+            size += m_memory_block_list[i].data_length() + sizeof(MemoryBlockParams_t);
+        }
+
+        if (size <= MEMORRY_BULK_READ_MAX_SIZE)
+        {
+            staging = new (std::nothrow) uint8_t[size];
+            if (staging == NULL)
+            {
+                DBIF_LOG_ERROR("No staging buffer for bulk read, Size: %i", size);
+            }
+        }
+    }
+
+    if (staging != NULL)
+    {
+        DBIF_LOG_INFO(".... Bulk Read: %i Bytes ....", size);
+        ret = (m_memory_interface->read(staging, start, size) == size);
+        if (ret == false)
+        {
+            /* Nothing has been copied yet, read_all() falls back to the per block reads */
+            DBIF_LOG_ERROR("Bulk Read failed, read Blocks one by one");
+        }
+    }
+
+    /* Same layout as get_offest(): data followed by the block parameter */
+    for (uint16_t i = 1; (staging != NULL) && ret && (i < m_memory_block_list.size()); i++)
+    {
+        memory_block = &m_memory_block_list[i];
+
+        copy_data(&staging[offset], memory_block->get_data(MemoryManagerType_e::MEMORY_DATA), memory_block->data_length());
+        copy_data(&staging[offset], memory_block->get_data(MemoryManagerType_e::USER_DATA), memory_block->data_length());
+        offset += memory_block->data_length();
+
+        memcpy(memory_block->bock_parameter(), &staging[offset], sizeof(MemoryBlockParams_t));
+        memory_block->reset_block_params_update();
+        offset += sizeof(MemoryBlockParams_t);
 
-        if(block_parameter_are_valid(i) == false)
+        if (memory_block->status() == MemoryManagerStatus_e::STATUS_DEFAULT)
+        {
+            load_defaults(i);
+        }
+
+        m_memory_block_state_list[i].loaded = true;
+        m_memory_block_state_list[i].ring_ready = false;
+        if (block_parameter_are_valid(i) == false)
         {
             read_all_blocks_valid = false;
             DBIF_LOG_DEBUG_0("Invalid Block Parameter_Nr: %i", i);
+            publish(EVENT_VERIFICATION_FAILED, i);
+            repair_block(i);
+        }
+        else
+        {
+            publish(EVENT_BLOCK_LOADED, i);
+        }
+    }
+
+    delete[] staging;
+    return ret;
+}
+#endif
+
+bool MemoryManager::load_block(uint16_t entry_idx)
+{
+    wait_io();
+    read_block_parameter(entry_idx); 
+    read_entry(entry_idx);            
+    return finish_load(entry_idx);
+}
+
+bool MemoryManager::finish_load(uint16_t entry_idx)
+{
+    bool valid = true;
+
+    if (m_memory_block_list[entry_idx].status() == MemoryManagerStatus_e::STATUS_DEFAULT)
+    {
+        /* Tombstone, the data bytes in memory were never written */
+        load_defaults(entry_idx);
+    }
+    m_memory_block_state_list[entry_idx].loaded = true;
+    m_memory_block_state_list[entry_idx].ring_ready = false;
+
+    if(block_parameter_are_valid(entry_idx) == false)
+    {
+        valid = false;
+        DBIF_LOG_DEBUG_0("Invalid Block Parameter_Nr: %i", entry_idx);
+    }
+    publish(valid ? EVENT_BLOCK_LOADED : EVENT_VERIFICATION_FAILED, entry_idx);
+    if (valid == false)
+    {
+        repair_block(entry_idx);
+    }
+    return valid;
+}
+
+bool MemoryManager::is_loaded(uint16_t entry_idx)
+{
+    return (m_load_mode == MemoryManagerLoad_e::LOAD_ALL_BLOCKS) || m_memory_block_state_list[entry_idx].loaded;
+}
+
+void MemoryManager::prefetch(void)
+{
+    bool loaded = false;
+
+    /* Load at most one block per call to keep the loop latency low */
+    for (; (m_prefetch_idx < m_memory_block_list.size()) && (loaded == false); m_prefetch_idx++)
+    {
+        if (is_loaded(m_prefetch_idx) == false)
+        {
+            DBIF_LOG_DEBUG_0("Prefetch Block %i", m_prefetch_idx);
+            load_block(m_prefetch_idx);
+            loaded = true;
         }
     }
-    return read_all_blocks_valid;
 }
 
 void MemoryManager::read_entry(uint16_t entry_idx)
 {
     bool ret = false;
-    uint16_t offset, memory_data_len;
-    uint16_t read_bytes = 0;
+    MemoryAddress_t offset, memory_data_len;
+    MemoryAddress_t read_bytes = 0;
     MemoryManagerBlock *memory_block;
     uint8_t *memory_data, *user_data;
 
-    DBIF_LOG_INFO(".... Read Entry: %i ....", entry_idx);
-
     memory_block = &m_memory_block_list[entry_idx];
     memory_data_len = m_memory_block_list[entry_idx].data_length();
 
     memory_data = memory_block->get_data(MemoryManagerType_e::MEMORY_DATA);
     user_data   = memory_block->get_data(MemoryManagerType_e::USER_DATA);
 
-    DBIF_LOG_DEBUG_0("User Data = %i, Memory Data = %i, Len= %i",user_data, memory_data, memory_data_len);
-
     offset = get_offest(entry_idx);
     read_bytes = m_memory_interface->read(memory_data, offset, memory_data_len);
+    MEMORY_TRACE(TRACE_READ_ENTRY, entry_idx, offset, read_bytes);
     copy_data(memory_data, user_data, memory_data_len);  
 }
 
 void MemoryManager::read_block_parameter(uint16_t entry_idx)
 {
-    uint16_t offset, memory_data_len;
+    MemoryAddress_t offset, memory_data_len;
     MemoryManagerBlock *memory_block;
     MemoryBlockParams_t *memory_bock_params;
 
@@ -61,38 +198,24 @@ void MemoryManager::read_block_parameter(uint16_t entry_idx)
     memory_block->reset_block_params_update();
 }
 
-uint16_t MemoryManager::get_offest(uint16_t idx)
+MemoryAddress_t MemoryManager::get_offest(uint16_t idx)
 {
-    uint16_t offset = 0;
+    MemoryAddress_t offset = 0;
    
-    if(idx > 0)
-    {
-        DBIF_LOG_DEBUG_0("Start Offset Calculation: ");
-        DBIF_LOG_DEBUG_0("--------------------------");
-        
-        DBIF_LOG_DEBUG_0("Idx | LEN | SIZE  | SUM");
-
-        for (uint16_t i = 0; i < idx; i++)
-        {
-            offset += m_memory_block_list.at(i).data_length() + sizeof(MemoryBlockParams_t);
-            DBIF_LOG_DEBUG_0(" %i :  %i +  %i  = %i", idx, m_memory_block_list.at(i).data_length(), sizeof(MemoryBlockParams_t),  m_memory_block_list.at(i).data_length() + sizeof(MemoryBlockParams_t) );
-        }
-        
-    }
-    else
+    for (uint16_t i = 0; i < idx; i++)
     {
-        DBIF_LOG_DEBUG_0("Skip Offset Calculation: ");
+        offset += m_memory_block_list.at(i).data_length() + sizeof(MemoryBlockParams_t);
     }
-    DBIF_LOG_DEBUG_0("SUM %i: Offset = %i",idx, offset);
+    MEMORY_TRACE(TRACE_OFFSET, idx, offset, 0);
     return offset;
 }
 
-void MemoryManager::copy_data(uint8_t *source, uint8_t *destination, int16_t size)
+void MemoryManager::copy_data(uint8_t *source, uint8_t *destination, MemoryAddress_t size)
 {
     if(source != NULL && destination != NULL && size >0)
     {
-        DBIF_LOG_DEBUG_0("Source: %i | Destination: %i | Length: %i",source,destination, size );
         memcpy(destination, source, size);
+        MEMORY_TRACE(TRACE_COPY, MEMORY_TRACE_NO_BLOCK, 0, size);
     }
     else 
     {
@@ -105,37 +228,202 @@ void MemoryManager::copy_data(uint8_t *source, uint8_t *destination, int16_t siz
 bool MemoryManager::write_all(MemoryBlockWrite_e write_flag, MemoryManagerType_e type)
 {
     bool write_success = false;
-    MemoryManagerBlock *current_block;
+    bool critical_written = false;
+    uint16_t entry_idx;
 
-    for (uint16_t i = 1; i < m_memory_block_list.size(); i++)
-    {   
-        current_block = &m_memory_block_list[i];
-        
-        if ((current_block->write_flag() == write_flag) ||
-            (write_flag == MemoryBlockWrite_e::WRITE_ALL_BLOCKS))
-        {
-           // DBIF_LOG_DEBUG_0("Entry %i: Request to write", i);
-            if(compare_entry(i,type)== MemoryDataCompare_e::MEMORY_DATA_NOT_EQUAL)
-            {       
-                DBIF_LOG_DEBUG_0("Entry %i: Differenzes found", i);
-                write_success = write_entry(i, type);
-                if(write_success)
+    wait_io();
+
+    /* The order is kept in place, a budgeted pass of loop() in progress keeps its order */
+    if (m_loop_cursor == 0)
+    {
+        flush_order(m_flush_order);
+    }
+
+    for (uint16_t i = 0; i < m_flush_order.size(); i++)
+    {
+        entry_idx = m_flush_order[i];
+
+        /* The critical class is committed before the others are written, so it is durable first */
+        if (critical_written && (m_memory_block_list[entry_idx].priority() != MemoryBlockPriority_e::PRIORITY_CRITICAL))
+        {
+            mark_unclean();
+            write_to_memory();
+            critical_written = false;
+        }
+
+        if ((write_block(entry_idx, write_flag, type, write_success) > 0) && (type == MemoryManagerType_e::USER_DATA))
+        {
+            critical_written = critical_written || (m_memory_block_list[entry_idx].priority() == MemoryBlockPriority_e::PRIORITY_CRITICAL);
+        }
+    }
+    return write_success;
+}
+
+void MemoryManager::flush_order(MemoryManagerBlockOrder &order)
+{
+    order.clear();
+    order.reserve(m_memory_block_list.size());
+
+    /* Bucket per priority class, stable within a class */
+    for (uint8_t priority = 0; priority < MemoryBlockPriority_e::PRIORITY_COUNT; priority++)
+    {
+        for (uint16_t i = 1; i < m_memory_block_list.size(); i++)
+        {
+            if (m_memory_block_list[i].priority() == priority)
+            {
+                order.push_back(i);
+            }
+        }
+    }
+}
+
+uint32_t MemoryManager::write_block(uint16_t entry_idx, MemoryBlockWrite_e write_flag, MemoryManagerType_e type, bool &write_success)
+{
+    uint32_t bytes_written = 0;
+    MemoryManagerBlock *current_block = &m_memory_block_list[entry_idx];
+
+    if ((current_block->field_count() > 0) && (type == MemoryManagerType_e::USER_DATA))
+    {
+        return write_fields(entry_idx, write_flag, write_success);
+    }
+
+    /* Ring logs are written record by record by append() */
+    if ((current_block->record_size() > 0) && (write_flag != MemoryBlockWrite_e::WRITE_ALL_BLOCKS))
+    {
+        return 0;
+    }
+
+    /* A block which was never loaded holds no valid user data */
+    if (((current_block->write_flag() == write_flag) ||
+         (write_flag == MemoryBlockWrite_e::WRITE_ALL_BLOCKS)) &&
+        ((type != MemoryManagerType_e::USER_DATA) || is_loaded(entry_idx)))
+    {
+        if((compare_entry(entry_idx,type)== MemoryDataCompare_e::MEMORY_DATA_NOT_EQUAL) &&
+           ((write_flag != MemoryBlockWrite_e::WRITE_ON_CHANGE) || (defer_write(entry_idx) == false)))
+        {       
+            bytes_written = write_whole_block(entry_idx, type, write_success);
+        }
+    }
+    return bytes_written;
+}
+
+uint32_t MemoryManager::write_fields(uint16_t entry_idx, MemoryBlockWrite_e write_flag, bool &write_success)
+{
+    MemoryManagerBlock *current_block = &m_memory_block_list[entry_idx];
+    MemoryBlockState_t *state = &m_memory_block_state_list[entry_idx];
+    const MemoryBlockField_t *field;
+    uint32_t now_ms = MemoryTimer::now_ms();
+    uint32_t bytes_written = 0;
+    uint32_t field_time;
+    MemoryAddress_t offset;
+    bool success = true;
+    bool dirty = false;
+    bool due;
+
+    if (is_loaded(entry_idx) == false)
+    {
+        return 0;
+    }
+
+    offset = get_offest(entry_idx);
+    for (uint16_t i = 0; i < current_block->field_count(); i++)
+    {
+        field = &current_block->fields()[i];
+        field_time = state->field_time_idx + i;
+        switch (field->write_flag)
+        {
+            case MemoryBlockWrite_e::WRITE_ON_CHANGE:
+                due = (write_flag == MemoryBlockWrite_e::WRITE_ON_CHANGE) || (write_flag == MemoryBlockWrite_e::WRITE_ALL_BLOCKS);
+                break;
+            case MemoryBlockWrite_e::WRITE_CYCLIC:
+                due = (write_flag == MemoryBlockWrite_e::WRITE_ALL_BLOCKS) ||
+                      ((write_flag == MemoryBlockWrite_e::WRITE_ON_CHANGE) &&
+                       ((field_time >= m_field_time_list.size()) || ((now_ms - m_field_time_list[field_time]) >= field->cycle_time_ms)));
+                break;
+            default:
+                /* WRITE_ON_SHUTDOWN and unconfigured fields are written by write_all() only */
+                due = (write_flag == MemoryBlockWrite_e::WRITE_ALL_BLOCKS);
+                break;
+        }
+
+        if (due && (field->offset + field->size <= current_block->data_length()) &&
+            (compare_data(current_block->user_data() + field->offset, current_block->eeprom_data() + field->offset, field->size) == MemoryDataCompare_e::MEMORY_DATA_NOT_EQUAL))
+        {
+            /* The first dirty field decides for the block, blocks without one are not touched */
+            if (dirty == false)
+            {
+                dirty = true;
+                if ((write_flag == MemoryBlockWrite_e::WRITE_ON_CHANGE) && defer_write(entry_idx))
+                {
+                    break;
+                }
+
+                /* A tombstone of lazy defaults holds no data in memory, it is replaced by the whole block */
+                if (current_block->status() != MemoryManagerStatus_e::STATUTS_OK)
                 {
-                    DBIF_LOG_DEBUG_0("Update Block Parameter for Entry  %i",i);
-                    write_success = write_block_parameter(i);
+                    return write_whole_block(entry_idx, MemoryManagerType_e::USER_DATA, write_success);
                 }
             }
+            copy_data(current_block->user_data() + field->offset, current_block->eeprom_data() + field->offset, field->size);
+            if (memory_write(entry_idx, MEMORY_IO_DATA, current_block->eeprom_data() + field->offset, offset + field->offset, field->size) > 0)
+            {
+                MEMORY_TRACE(TRACE_WRITE_ENTRY, entry_idx, offset + field->offset, field->size);
+            }
+            else
+            {
+                MEMORY_TRACE(TRACE_WRITE_ERROR, entry_idx, offset + field->offset, field->size);
+                DBIF_LOG_ERROR("Entry %i: Error during write of Field %i", entry_idx, i);
+                success = false;
+            }
+            bytes_written += field->size;
+            if (field_time < m_field_time_list.size())
+            {
+                m_field_time_list[field_time] = now_ms;
+            }
         }
     }
-    return write_success;
+
+    if (bytes_written > 0)
+    {
+        /* The parameters carry the CRC over the whole block */
+        current_block->status(MemoryManagerStatus_e::STATUTS_OK);
+        success = write_block_parameter(entry_idx) && success;
+        bytes_written += sizeof(MemoryBlockParams_t);
+        write_success = success;
+        state->uncommitted = true;
+    }
+
+    /* Bytes not covered by a field would keep the block different forever */
+    if ((write_flag == MemoryBlockWrite_e::WRITE_ALL_BLOCKS) && (compare_entry(entry_idx) == MemoryDataCompare_e::MEMORY_DATA_NOT_EQUAL))
+    {
+        bytes_written += write_whole_block(entry_idx, MemoryManagerType_e::USER_DATA, write_success);
+    }
+    return bytes_written;
+}
+
+uint32_t MemoryManager::write_whole_block(uint16_t entry_idx, MemoryManagerType_e type, bool &write_success)
+{
+    MemoryManagerBlock *current_block = &m_memory_block_list[entry_idx];
+    uint32_t bytes_written;
+
+    MEMORY_TRACE(TRACE_WRITE_REQUEST, entry_idx, 0, current_block->data_length());
+    write_success = write_entry(entry_idx, type);
+    bytes_written = current_block->data_length();
+    if (write_success)
+    {
+        write_success = write_block_parameter(entry_idx);
+        bytes_written += sizeof(MemoryBlockParams_t);
+    }
+    m_memory_block_state_list[entry_idx].uncommitted |= (type == MemoryManagerType_e::USER_DATA);
+    return bytes_written;
 }
 
 bool MemoryManager::write_entry(uint16_t entry_idx, MemoryManagerType_e data_type)
 {
-    uint16_t offset, data_len;
+    MemoryAddress_t offset, data_len;
     MemoryManagerBlock *memory_block;
     uint8_t *memory_data, *write_data;
-    uint16_t bytes_written = 0;
+    MemoryAddress_t bytes_written = 0;
 
     memory_block = &m_memory_block_list[entry_idx];
     memory_data  = memory_block->get_data(MemoryManagerType_e::MEMORY_DATA);
@@ -148,15 +436,16 @@ bool MemoryManager::write_entry(uint16_t entry_idx, MemoryManagerType_e data_typ
     {
         copy_data(write_data, memory_data, data_len);
         offset = get_offest(entry_idx);
-        bytes_written = m_memory_interface->write(memory_data, offset, data_len);
+        bytes_written = memory_write(entry_idx, MEMORY_IO_DATA, memory_data, offset, data_len);
         if(bytes_written)
         {
-            DBIF_LOG_DEBUG_0("Entry %i: Successfully written to Memory");
+            MEMORY_TRACE(TRACE_WRITE_ENTRY, entry_idx, offset, bytes_written);
             memory_block->status(MemoryManagerStatus_e::STATUTS_OK);
         }
         else 
         {
-             DBIF_LOG_ERROR("Entry %i: Error during write progress to Memory");
+             MEMORY_TRACE(TRACE_WRITE_ERROR, entry_idx, offset, data_len);
+             DBIF_LOG_ERROR("Entry %i: Error during write progress to Memory", entry_idx);
         }
     }
     else
@@ -170,7 +459,7 @@ bool MemoryManager::write_entry(uint16_t entry_idx, MemoryManagerType_e data_typ
 bool MemoryManager::write_block_parameter(uint16_t entry_idx)
 {
     bool update_parameter = false;
-    uint16_t offset, data_len;
+    MemoryAddress_t offset;
     MemoryManagerBlock *memory_block;
     MemoryBlockParams_t *parameter;
     uint8_t *memory_data, *write_data;
@@ -181,18 +470,21 @@ bool MemoryManager::write_block_parameter(uint16_t entry_idx)
     {
         offset = get_offest(entry_idx) + memory_block->data_length();
         parameter = m_memory_block_list[entry_idx].bock_parameter();
+        parameter->crc = block_crc(memory_block, *parameter, memory_block->eeprom_data());
 
-        m_memory_interface->write(reinterpret_cast<uint8_t *>(parameter),
-                                  offset,
-                                  sizeof(MemoryBlockParams_t));
-        update_parameter = true;
+        update_parameter = (memory_write(entry_idx,
+                                         MEMORY_IO_PARAMETER,
+                                         reinterpret_cast<uint8_t *>(parameter),
+                                         offset,
+                                         sizeof(MemoryBlockParams_t)) > 0);
+        MEMORY_TRACE(TRACE_WRITE_PARAMETER, entry_idx, offset, sizeof(MemoryBlockParams_t));
     }
     
     return update_parameter;
 }
 
 
-MemoryDataCompare_e MemoryManager::compare_data(uint8_t *source_1, uint8_t *source_2, int16_t size)
+MemoryDataCompare_e MemoryManager::compare_data(uint8_t *source_1, uint8_t *source_2, MemoryAddress_t size)
 {
     MemoryDataCompare_e ret = MemoryDataCompare_e::MEMORY_DATA_NOT_EQUAL;
     
@@ -230,6 +522,7 @@ int16_t MemoryManager::exists(MemoryManagerBlock &memory_block)
 void MemoryManager::delete_entry(uint16_t entry_idx, bool delete_memory_data)
 {
     MemoryManagerBlock block;
+    wait_io();
     if(entry_idx < m_memory_block_list.size())
     {
         block = m_memory_block_list.at(entry_idx);
@@ -243,6 +536,11 @@ void MemoryManager::delete_entry(uint16_t entry_idx, bool delete_memory_data)
 
         m_memory_block_list.erase(m_memory_block_list.begin() + entry_idx);
         m_memory_block_param_list.erase(m_memory_block_param_list.begin() + entry_idx);
+        m_memory_block_state_list.erase(m_memory_block_state_list.begin() + entry_idx);
+        m_stats.remove_block(entry_idx);
+
+        /* The flush order of a running pass refers to the old indices */
+        m_loop_cursor = 0;
     }
     else
     {
@@ -252,96 +550,975 @@ void MemoryManager::delete_entry(uint16_t entry_idx, bool delete_memory_data)
 
 bool MemoryManager::block_parameter_are_valid(uint16_t entry_idx)
 {   
-    bool ret = true;
-    
-    //MemoryBlockParams_t *parameter = m_memory_block_list[entry_idx].bock_parameter();
-    //if (parameter->status == MemoryManagerStatus_e::STATUTS_OK)
-    //{
-    //    DBIF_LOG_DEBUG_0("Block Parameter Valid Entry: %i",entry_idx);
-    //    ret = true;
-    //} 
-    //else
-    //{
-    //    DBIF_LOG_DEBUG_0("Block Parameter Invalid Entry: %i",entry_idx);
-    //}
+    bool ret = false;
+    MemoryManagerBlock *memory_block = &m_memory_block_list[entry_idx];
+    MemoryBlockParams_t *parameter = memory_block->bock_parameter();
+
+    /* Parameters torn by a power cut are out of range or fail the CRC, so does torn data */
+    if (((parameter->status == MemoryManagerStatus_e::STATUTS_OK) || (parameter->status == MemoryManagerStatus_e::STATUS_DEFAULT)) &&
+        (parameter->write_flag < MemoryBlockWrite_e::WRITE_ALL_BLOCKS))
+    {
+        /* An image left by a clean shutdown() is trusted, the CRC is only computed after an unclean one */
+        ret = (m_verify_blocks == false) || (parameter->crc == block_crc(memory_block, *parameter, memory_block->eeprom_data()));
+    }
+
+    if (ret == false)
+    {
+        DBIF_LOG_DEBUG_0("Block Parameter Invalid Entry: %i",entry_idx);
+    }
     return ret;
 }
 
+uint32_t MemoryManager::block_crc(MemoryManagerBlock *memory_block, const MemoryBlockParams_t &params, const uint8_t *data)
+{
+    uint32_t crc = 0;
 
-bool MemoryManager::write_to_memory(void)
+    /* A tombstone holds no data in memory, the records of a ring log carry their own CRC */
+    if ((params.status == MemoryManagerStatus_e::STATUTS_OK) && (memory_block->record_size() == 0) && (data != NULL))
+    {
+        crc = MemoryCrc_crc32(data, memory_block->data_length());
+    }
+    return MemoryCrc_crc32(reinterpret_cast<const uint8_t *>(&params), offsetof(MemoryBlockParams_t, crc), crc);
+}
+
+void MemoryManager::repair_block(uint16_t entry_idx)
 {
-    return m_memory_interface->commit();
+    MemoryManagerBlock *memory_block = &m_memory_block_list[entry_idx];
+    bool written = false;
+
+    /* The content is lost, the configured parameters replace the ones read */
+    *memory_block->bock_parameter() = MemoryBlockParams_t{};
+    memory_block->write_flag(m_memory_block_state_list[entry_idx].write_flag);
+    load_defaults(entry_idx);
+    m_memory_block_state_list[entry_idx].pending = false;
+
+#if MEMORRY_LAZY_DEFAULTS_ENABLED == true
+    memory_block->status(MemoryManagerStatus_e::STATUS_DEFAULT);
+    written = write_block_parameter(entry_idx);
+#else
+    write_whole_block(entry_idx, MemoryManagerType_e::USER_DATA, written);
+#endif
+    m_memory_block_state_list[entry_idx].uncommitted = true;
+    if (m_uncommitted == false)
+    {
+        m_uncommitted_since_ms = MemoryTimer::now_ms();
+    }
+    m_uncommitted = true;
+
+    if (written == false)
+    {
+        DBIF_LOG_ERROR("Entry %i: Repair with Default Data failed", entry_idx);
+    }
+    publish(EVENT_DEFAULTS_RESTORED, entry_idx);
 }
 
 
-MemoryManagerStatus_e MemoryManager::verify_memory(void)
+bool MemoryManager::write_to_memory(void)
 {
-    MemoryManagerStatus_e ret = MemoryManagerStatus_e::STATUS_ERROR;
-    bool blocks_valid = false;
-    // Version compare to check whether new Version available
+    bool ret;
+    uint32_t start_us = MemoryStats::now_us();
 
-    MemoryManagerVersion_t memory_version = get_block(MEMORY_HEADER_ENTRY)->user_data<MemoryManagerHeader_t>()->version;
-    
-    DBIF_LOG_DEBUG_0("m_current_version <= memory_version = %i",m_current_version <= get_block(MEMORY_HEADER_ENTRY)->user_data<MemoryManagerHeader_t>()->version);
-    DBIF_LOG_DEBUG_1("Current Version: %i.%i.%i",m_current_version.str.major,m_current_version.str.minor,m_current_version.str.patch);
-    DBIF_LOG_DEBUG_1("Memory  Version: %i.%i.%i",memory_version.str.major,memory_version.str.minor,memory_version.str.patch);
+#if MEMORRY_ASYNC_ENABLED == true
+    if (m_io_async)
+    {
+        /* Queued behind the writes of the pass, completes in io_complete() */
+        m_io_commit_start_us = start_us;
+        m_io_pending++;
+        ret = m_memory_interface->commit_async(&MemoryManager::io_complete, this, MEMORY_IO_COMMIT);
+        m_io_pending -= (ret ? 0u : 1u);
+        return ret;
+    }
+#endif
+
+    ret = m_memory_interface->commit();
+    commit_complete(ret, MemoryStats::now_us() - start_us);
+    return ret;
+}
 
+void MemoryManager::commit_complete(bool success, uint32_t duration_us)
+{
+    MEMORY_TRACE(TRACE_COMMIT, MEMORY_TRACE_NO_BLOCK, 0, success);
+    m_stats.committed(duration_us, success);
 
-    if (m_current_version <= memory_version)
+    if (success)
     {
-        
-        DBIF_LOG_DEBUG_0("Memory Version up to date");
-        
-        blocks_valid = read_all();
-        
-        if(blocks_valid)
+        m_uncommitted = false;
+        m_cold_written = false;
+        m_uncommitted_bytes = 0;
+        m_last_commit_ms = MemoryTimer::now_ms();
+
+        for (uint16_t i = 1; i < m_memory_block_state_list.size(); i++)
         {
-            DBIF_LOG_DEBUG_0("Memory Init Successful");            
-            ret = MemoryManagerStatus_e::STATUTS_OK;
+            if (m_memory_block_state_list[i].uncommitted)
+            {
+                m_memory_block_state_list[i].uncommitted = false;
+                publish(EVENT_BLOCK_PERSISTED, i);
+            }
+        }
+    }
+}
+
+MemoryAddress_t MemoryManager::memory_write(uint16_t entry_idx, uint32_t io_type, uint8_t *data_ptr, MemoryAddress_t offset, MemoryAddress_t len)
+{
+    MemoryAddress_t bytes_written = 0;
+
+#if MEMORRY_ASYNC_ENABLED == true
+    if (m_io_async)
+    {
+        if ((m_io_length.size() >= m_io_length.max_size()) && (wait_io() == false))
+        {
+            return 0;
+        }
+        /* Field writes and appends are shorter than the block, the completion needs the real length.
+           Counted first, backends without asynchronous transfers complete within write_async() */
+        m_io_length.push_back(len);
+        m_io_pending++;
+        if (m_memory_interface->write_async(data_ptr, offset, len, &MemoryManager::io_complete, this, io_type | entry_idx))
+        {
+            bytes_written = len;
         }
         else
         {
-            DBIF_LOG_ERROR("Memory Init ERROR");        
-            ret = MemoryManagerStatus_e::STATUS_ERROR;
+            m_io_pending--;
+            m_io_length.erase(m_io_length.end() - 1);
         }
+        return bytes_written;
     }
-    else
-    {
-        DBIF_LOG_DEBUG_0("Memory Version update needed, Write Default Data");
-        
-        // Update of MEMORY. Version differs.
-        blocks_valid = write_all(WRITE_ALL_BLOCKS, DEFAULT_DATA);
+#endif
 
-        DBIF_LOG_DEBUG_1("Update Status = %i",blocks_valid);
+    bytes_written = m_memory_interface->write(data_ptr, offset, len);
+    m_stats.written(entry_idx, len, bytes_written > 0);
+    return bytes_written;
+}
 
-        if(blocks_valid)
-        {
-            
-            update_memory_version(m_current_version);
-            blocks_valid = write_entry(MEMORY_HEADER_ENTRY);
-            DBIF_LOG_DEBUG_1("WRITE Entry Status: %i", blocks_valid);
+#if MEMORRY_ASYNC_ENABLED == true
+void MemoryManager::io_complete(void *context, uint32_t tag, bool success)
+{
+    MemoryManager *manager = static_cast<MemoryManager *>(context);
+    uint16_t entry_idx = tag & 0xFFFFu;
+    uint32_t io_type = tag & 0xFFFF0000u;
+    MemoryAddress_t len = 0;
 
-            blocks_valid = write_to_memory();
-            DBIF_LOG_DEBUG_1("WRITE To Memory Status: %i", blocks_valid);
+    manager->m_io_pending--;
 
-            if(blocks_valid)
-            {
-                ret = MemoryManagerStatus_e::STATUS_UNINIT;
-            }
-            else 
+    if (io_type == MEMORY_IO_COMMIT)
+    {
+        manager->commit_complete(success, MemoryStats::now_us() - manager->m_io_commit_start_us);
+        manager->m_stats.flushed(MemoryStats::now_us() - manager->m_io_flush_start_us);
+    }
+    else
+    {
+        /* Writes complete in the order they were issued */
+        if (manager->m_io_length.empty() == false)
+        {
+            len = manager->m_io_length[0];
+            manager->m_io_length.erase(manager->m_io_length.begin());
+        }
+
+        if (entry_idx < manager->m_memory_block_list.size())
+        {
+            manager->m_stats.written(entry_idx, len, success);
+            if (success == false)
             {
-                DBIF_LOG_ERROR("Memory Version Update Failed");
+                manager->m_pass_ok = false;
+                MEMORY_TRACE(TRACE_WRITE_ERROR, entry_idx, 0, 0);
+                DBIF_LOG_ERROR("Entry %i: Error during asynchronous write to Memory", entry_idx);
+                manager->m_memory_block_list[entry_idx].status(MemoryManagerStatus_e::STATUS_NOT_OK);
             }
         }
-        else 
+    }
+}
+#endif
+
+void MemoryManager::publish(MemoryManagerEvent_e event, uint16_t entry_idx)
+{
+    for (uint16_t i = 0; i < m_subscriber_list.size(); i++)
+    {
+        if (m_subscriber_list[i].mask & MEMORY_EVENT_MASK(event))
         {
-            DBIF_LOG_ERROR("Memory Init Write Default Data ERROR");
-            ret = MemoryManagerStatus_e::STATUS_NOT_OK;
+            m_subscriber_list[i].callback(m_subscriber_list[i].context, event, entry_idx);
         }
     }
-    return ret;
 }
 
+bool MemoryManager::work_pending(void)
+{
+    return m_change_pending ||
+           m_uncommitted ||
+           (m_waiter_list.empty() == false) ||
+           ((m_load_mode == MemoryManagerLoad_e::LOAD_ON_DEMAND_PREFETCH) && (m_prefetch_idx < m_memory_block_list.size()));
+}
+
+#if MEMORRY_TRANSACTION_ENABLED == true
+MemoryAddress_t MemoryManager::journal_offset(void)
+{
+    return get_offest(m_memory_block_list.size());
+}
+
+bool MemoryManager::replay_journal(void)
+{
+    MemoryJournalHeader_t journal;
+    MemoryJournalEntry_t entry;
+    MemoryAddress_t start = journal_offset();
+    MemoryAddress_t offset;
+    uint8_t *staging;
+    bool valid;
+    bool written;
+
+    m_memory_interface->read(reinterpret_cast<uint8_t *>(&journal), start, sizeof(journal));
+    if ((journal.magic != MEMORY_JOURNAL_MAGIC) || (journal.count == 0) ||
+        (journal.length > (MEMORRY_JOURNAL_SIZE - sizeof(MemoryJournalHeader_t))))
+    {
+        return false;
+    }
+
+    staging = new (std::nothrow) uint8_t[journal.length];
+    if (staging == NULL)
+    {
+        DBIF_LOG_ERROR("No staging buffer for the Journal, Size: %i", journal.length);
+        return false;
+    }
+    m_memory_interface->read(staging, start + sizeof(journal), journal.length);
+
+    /* Nothing is applied unless the complete journal is intact and matches the blocks */
+    valid = (journal.crc == MemoryCrc_crc32(reinterpret_cast<uint8_t *>(&journal), offsetof(MemoryJournalHeader_t, crc),
+                                            MemoryCrc_crc32(staging, journal.length)));
+    offset = 0;
+    for (uint16_t i = 0; (i < journal.count) && valid; i++)
+    {
+        valid = ((offset + sizeof(entry)) <= journal.length);
+        if (valid)
+        {
+            memcpy(&entry, &staging[offset], sizeof(entry));
+            valid = (entry.entry_idx != MEMORY_HEADER_ENTRY) &&
+                    (entry.entry_idx < m_memory_block_list.size()) &&
+                    (entry.length == m_memory_block_list[entry.entry_idx].data_length()) &&
+                    ((offset + sizeof(entry) + entry.length) <= journal.length);
+            offset += sizeof(entry) + entry.length;
+        }
+    }
+
+    if (valid == false)
+    {
+        DBIF_LOG_ERROR("Invalid Transaction Journal discarded");
+    }
+    else
+    {
+        DBIF_LOG_DEBUG_0("Replay Transaction Journal, %i Blocks", journal.count);
+        offset = 0;
+        for (uint16_t i = 0; i < journal.count; i++)
+        {
+            memcpy(&entry, &staging[offset], sizeof(entry));
+            copy_data(&staging[offset + sizeof(entry)], get_block(entry.entry_idx)->user_data(), entry.length);
+            written = true;
+            write_block(entry.entry_idx, MemoryBlockWrite_e::WRITE_ALL_BLOCKS, MemoryManagerType_e::USER_DATA, written);
+            valid = valid && written;
+            offset += sizeof(entry) + entry.length;
+        }
+    }
+
+    delete[] staging;
+    if (valid)
+    {
+        invalidate_journal();
+    }
+    return valid;
+}
+
+bool MemoryManager::invalidate_journal(void)
+{
+    uint32_t magic = 0;
+
+    return (memory_write(MEMORY_HEADER_ENTRY, MEMORY_IO_DATA, reinterpret_cast<uint8_t *>(&magic), journal_offset(), sizeof(magic)) > 0);
+}
+#endif
+
+bool MemoryManager::wait_io(void)
+{
+    uint32_t start_ms = MemoryTimer::now_ms();
+    bool ret = true;
+
+    while ((m_io_pending > 0) && ret)
+    {
+        m_memory_interface->poll();
+        if (m_io_pending > 0)
+        {
+            MemoryTimer::relax();
+            ret = ((MemoryTimer::now_ms() - start_ms) < MEMORRY_IO_TIMEOUT_MS);
+        }
+    }
+
+    if (ret == false)
+    {
+        DBIF_LOG_ERROR("Asynchronous Memory timed out, %i Requests outstanding", m_io_pending);
+    }
+    return ret;
+}
+
+bool MemoryManager::defer_write(uint16_t entry_idx)
+{
+    MemoryBlockState_t *state = &m_memory_block_state_list[entry_idx];
+    uint32_t now_ms = MemoryTimer::now_ms();
+    bool defer = false;
+
+    if (m_heat_policy.half_life_ms == 0)
+    {
+        return false;
+    }
+
+    /* The caller found the block dirty. While a change is deferred the block stays dirty,
+       further changes are only counted when reported by block_changed() */
+    if ((state->pending == false) || state->change_reported)
+    {
+        decay_write_rate(entry_idx, now_ms);
+        state->write_rate = (state->write_rate > (0xFFFFu - 256u)) ? 0xFFFFu : (state->write_rate + 256u);
+        if ((state->hot == false) && (state->write_rate >= ((uint32_t)m_heat_policy.hot_threshold << 8)))
+        {
+            state->hot = true;
+            place_block(entry_idx);
+        }
+        state->change_reported = false;
+        if (state->pending == false)
+        {
+            state->pending = true;
+            state->pending_since_ms = now_ms;
+        }
+    }
+
+    /* sync() writes deferred changes as well */
+    if (state->hot && (m_sync_active == false) && ((now_ms - state->pending_since_ms) < m_heat_policy.hot_max_delay_ms))
+    {
+        defer = true;
+        m_change_pending = true;
+    }
+    else
+    {
+        state->pending = false;
+        m_cold_written = m_cold_written || (state->hot == false);
+    }
+    return defer;
+}
+
+void MemoryManager::decay_write_rate(uint16_t entry_idx, uint32_t now_ms)
+{
+    MemoryBlockState_t *state = &m_memory_block_state_list[entry_idx];
+    uint32_t elapsed = now_ms - state->rate_updated_ms;
+    uint32_t half_lifes = elapsed / m_heat_policy.half_life_ms;
+    uint32_t rate = state->write_rate;
+
+    rate = (half_lifes < 16u) ? (rate >> half_lifes) : 0u;
+    /* Linear approximation of the remaining fraction of a half-life */
+    rate -= (rate * (elapsed % m_heat_policy.half_life_ms)) / (2u * m_heat_policy.half_life_ms);
+
+    state->write_rate = rate;
+    state->rate_updated_ms = now_ms;
+    if (state->hot && (rate < ((m_heat_policy.cold_threshold != 0) ? ((uint32_t)m_heat_policy.cold_threshold << 8) : ((uint32_t)m_heat_policy.hot_threshold << 7))))
+    {
+        state->hot = false;
+        place_block(entry_idx);
+    }
+}
+
+MemoryBlockTemperature_e MemoryManager::block_temperature(uint16_t entry_idx)
+{
+    MemoryBlockTemperature_e ret = MemoryBlockTemperature_e::BLOCK_COLD;
+
+    if ((entry_idx < m_memory_block_state_list.size()) && (m_heat_policy.half_life_ms != 0))
+    {
+        decay_write_rate(entry_idx, MemoryTimer::now_ms());
+        ret = m_memory_block_state_list[entry_idx].hot ? MemoryBlockTemperature_e::BLOCK_HOT : MemoryBlockTemperature_e::BLOCK_COLD;
+    }
+    return ret;
+}
+
+void MemoryManager::place_block(uint16_t entry_idx)
+{
+    /* A migration copies the block, it must not overtake outstanding writes */
+    wait_io();
+    m_memory_interface->place(get_offest(entry_idx),
+                              m_memory_block_list[entry_idx].data_length() + sizeof(MemoryBlockParams_t),
+                              m_memory_block_state_list[entry_idx].hot ? MemoryBlockTemperature_e::BLOCK_HOT : MemoryBlockTemperature_e::BLOCK_COLD);
+}
+
+bool MemoryManager::commit_due(void)
+{
+    uint32_t now_ms = MemoryTimer::now_ms();
+
+    return ((now_ms - m_last_commit_ms) >= m_commit_policy.min_interval_ms) ||
+           ((m_commit_policy.max_staleness_ms != 0) && ((now_ms - m_uncommitted_since_ms) >= m_commit_policy.max_staleness_ms)) ||
+           ((m_commit_policy.max_dirty_bytes != 0) && (m_uncommitted_bytes >= m_commit_policy.max_dirty_bytes));
+}
+
+
+MemoryManagerStatus_e MemoryManager::verify_memory(void)
+{
+    MemoryManagerStatus_e ret = MemoryManagerStatus_e::STATUS_ERROR;
+    bool blocks_valid = false;
+    MemoryManagerHeader_t *header = get_block(MEMORY_HEADER_ENTRY)->user_data<MemoryManagerHeader_t>();
+    bool header_valid = (header->header_crc == MemoryCrc_crc32(reinterpret_cast<uint8_t *>(header), offsetof(MemoryManagerHeader_t, header_crc)));
+    MemoryAddress_t legacy_header_length = 0;
+    bool layout_current = false;
+    // Version compare to check whether new Version available
+
+    MemoryManagerVersion_t memory_version = header->version;
+    
+    DBIF_LOG_DEBUG_0("m_current_version <= memory_version = %i",m_current_version <= get_block(MEMORY_HEADER_ENTRY)->user_data<MemoryManagerHeader_t>()->version);
+    DBIF_LOG_DEBUG_1("Current Version: %i.%i.%i",m_current_version.str.major,m_current_version.str.minor,m_current_version.str.patch);
+    DBIF_LOG_DEBUG_1("Memory  Version: %i.%i.%i",memory_version.str.major,memory_version.str.minor,memory_version.str.patch);
+
+    /* An image with another header layout has all blocks at other offsets */
+    if (header_valid && (header->format == MEMORY_HEADER_FORMAT))
+    {
+        layout_current = true;
+    }
+    else if (header->format == MEMORY_HEADER_FORMAT_V3)
+    {
+        legacy_header_length = sizeof(MemoryManagerHeader_t);
+    }
+    else if ((header_valid == false) && (header->format != MEMORY_HEADER_FORMAT) && (header->key == MemoryManagerStatus_e::STATUS_UNINIT))
+    {
+        /* First layout, the header holds the version and the key only. Moved blocks of an interrupted migration pass their CRC */
+        legacy_header_length = offsetof(MemoryManagerHeader_t, format);
+    }
+    else if ((header_valid == false) && image_has_valid_block())
+    {
+        /* Header torn by a power cut, its version cannot be trusted but the blocks can */
+        DBIF_LOG_ERROR("Invalid Header, Blocks are valid");
+        update_memory_version(m_current_version);
+        memory_version = m_current_version;
+        layout_current = true;
+    }
+
+    if ((legacy_header_length > 0) && (m_current_version <= memory_version))
+    {
+        DBIF_LOG_INFO(".... Migrate Image to the current Header Format ....");
+        if (migrate_image(legacy_header_length) && write_header(MemoryManagerStatus_e::STATUS_NOT_OK, false) && write_to_memory())
+        {
+            ret = MemoryManagerStatus_e::STATUTS_OK;
+        }
+        else
+        {
+            DBIF_LOG_ERROR("Memory Migration Failed");
+            ret = MemoryManagerStatus_e::STATUS_ERROR;
+        }
+    }
+    else if (layout_current && (m_current_version <= memory_version))
+    {
+        
+        DBIF_LOG_DEBUG_0("Memory Version up to date");
+        
+        if (m_load_mode == MemoryManagerLoad_e::LOAD_ALL_BLOCKS)
+        {
+            blocks_valid = read_all();
+        }
+        else
+        {
+            /* Blocks are read on their first access */
+            blocks_valid = (load_verified_memory() == MemoryManagerStatus_e::STATUTS_OK);
+        }
+        
+        if(blocks_valid)
+        {
+            DBIF_LOG_DEBUG_0("Memory Init Successful");            
+            ret = MemoryManagerStatus_e::STATUTS_OK;
+        }
+        else
+        {
+            DBIF_LOG_ERROR("Memory Init ERROR");        
+            ret = MemoryManagerStatus_e::STATUS_ERROR;
+        }
+    }
+    else
+    {
+        if ((layout_current == false) && (legacy_header_length == 0))
+        {
+            DBIF_LOG_ERROR("Unknown Header Format, Write Default Data");
+        }
+        DBIF_LOG_DEBUG_0("Memory Version update needed, Write Default Data");
+
+#if MEMORRY_LAZY_DEFAULTS_ENABLED == true
+        /* Only the parameters are written, the data is taken from default_data when read */
+        blocks_valid = write_lazy_defaults();
+#else
+#if MEMORRY_FACTORY_IMAGE_ENABLED == true
+        if (write_factory_image())
+        {
+            publish(EVENT_DEFAULTS_RESTORED, MEMORY_HEADER_ENTRY);
+            return MemoryManagerStatus_e::STATUS_UNINIT;
+        }
+#endif
+
+        // Update of MEMORY. Version differs.
+        blocks_valid = write_all(WRITE_ALL_BLOCKS, DEFAULT_DATA);
+#endif
+
+        DBIF_LOG_DEBUG_1("Update Status = %i",blocks_valid);
+
+        if(blocks_valid)
+        {
+            
+            update_memory_version(m_current_version);
+            blocks_valid = write_header(MemoryManagerStatus_e::STATUS_NOT_OK, false);
+            DBIF_LOG_DEBUG_1("WRITE Entry Status: %i", blocks_valid);
+
+            blocks_valid = write_to_memory();
+            DBIF_LOG_DEBUG_1("WRITE To Memory Status: %i", blocks_valid);
+
+            if(blocks_valid)
+            {
+                ret = MemoryManagerStatus_e::STATUS_UNINIT;
+                publish(EVENT_DEFAULTS_RESTORED, MEMORY_HEADER_ENTRY);
+            }
+            else 
+            {
+                DBIF_LOG_ERROR("Memory Version Update Failed");
+            }
+        }
+        else 
+        {
+            DBIF_LOG_ERROR("Memory Init Write Default Data ERROR");
+            ret = MemoryManagerStatus_e::STATUS_NOT_OK;
+        }
+    }
+    return ret;
+}
+
+
+bool MemoryManager::image_has_valid_block(void)
+{
+    bool ret = false;
+    bool verify_blocks = m_verify_blocks;
+
+    m_verify_blocks = true;
+    for (uint16_t i = 1; (i < m_memory_block_list.size()) && (ret == false); i++)
+    {
+        read_block_parameter(i);
+        read_entry(i);
+        ret = block_parameter_are_valid(i);
+    }
+    m_verify_blocks = verify_blocks;
+
+    /* The defaults are written with the configured parameters */
+    for (uint16_t i = 1; (i < m_memory_block_list.size()) && (ret == false); i++)
+    {
+        *m_memory_block_list[i].bock_parameter() = MemoryBlockParams_t{};
+        m_memory_block_list[i].write_flag(m_memory_block_state_list[i].write_flag);
+    }
+    return ret;
+}
+
+bool MemoryManager::migrate_image(MemoryAddress_t header_length)
+{
+    MemoryAddress_t params_length = offsetof(MemoryBlockParams_t, crc);
+    MemoryManagerHeader_t *header = get_block(MEMORY_HEADER_ENTRY)->user_data<MemoryManagerHeader_t>();
+    MemoryManagerBlock *memory_block;
+    MemoryBlockParams_t *parameter;
+    MemoryAddress_t offset;
+    bool ret = true;
+    bool written;
+
+    /* Fields the old header did not have */
+    memset(reinterpret_cast<uint8_t *>(header) + header_length, 0x00, sizeof(MemoryManagerHeader_t) - header_length);
+
+    /* Header and parameters only grew, every block moves to a higher offset */
+    for (uint16_t i = m_memory_block_list.size() - 1u; i > 0; i--)
+    {
+        memory_block = &m_memory_block_list[i];
+        parameter = memory_block->bock_parameter();
+        m_memory_block_state_list[i].loaded = true;
+        m_memory_block_state_list[i].ring_ready = false;
+
+        /* A block which passes its CRC was moved before the migration was interrupted */
+        read_block_parameter(i);
+        read_entry(i);
+        if (block_parameter_are_valid(i))
+        {
+            continue;
+        }
+
+        offset = header_length + params_length;
+        for (uint16_t j = 1; j < i; j++)
+        {
+            offset += m_memory_block_list[j].data_length() + params_length;
+        }
+        m_memory_interface->read(memory_block->eeprom_data(), offset, memory_block->data_length());
+        copy_data(memory_block->eeprom_data(), memory_block->user_data(), memory_block->data_length());
+        *parameter = MemoryBlockParams_t{};
+        m_memory_interface->read(reinterpret_cast<uint8_t *>(parameter), offset + memory_block->data_length(), params_length);
+
+        written = false;
+        if (((parameter->status != MemoryManagerStatus_e::STATUTS_OK) && (parameter->status != MemoryManagerStatus_e::STATUS_DEFAULT)) ||
+            (parameter->write_flag >= MemoryBlockWrite_e::WRITE_ALL_BLOCKS))
+        {
+            DBIF_LOG_ERROR("Entry %i: Invalid Block Parameter, Write Default Data", i);
+            repair_block(i);
+            written = true;
+        }
+        else if (parameter->status == MemoryManagerStatus_e::STATUS_DEFAULT)
+        {
+            /* Tombstone of lazy defaults, only the parameters move */
+            load_defaults(i);
+            memory_block->status(MemoryManagerStatus_e::STATUS_DEFAULT);
+            written = write_block_parameter(i);
+        }
+        else
+        {
+            write_whole_block(i, MemoryManagerType_e::USER_DATA, written);
+        }
+        ret = ret && written;
+    }
+    return ret;
+}
+
+void MemoryManager::stage_image(const uint8_t *data, MemoryAddress_t offset, MemoryAddress_t len)
+{
+    MemoryAddress_t block_offset = 0;
+    MemoryAddress_t pos, part, data_part;
+    MemoryManagerBlock *memory_block;
+
+    /* Same layout as get_offest(): data followed by the block parameter */
+    for (uint16_t i = 0; (i < m_memory_block_list.size()) && (len > 0); i++)
+    {
+        memory_block = &m_memory_block_list[i];
+        if (offset < block_offset + memory_block->data_length() + sizeof(MemoryBlockParams_t))
+        {
+            pos = offset - block_offset;
+            part = memory_block->data_length() + sizeof(MemoryBlockParams_t) - pos;
+            part = (part < len) ? part : len;
+            data_part = (pos < memory_block->data_length()) ? (memory_block->data_length() - pos) : 0u;
+            data_part = (data_part < part) ? data_part : part;
+
+            memcpy(memory_block->eeprom_data() + pos, data, data_part);
+            if (part > data_part)
+            {
+                memcpy(reinterpret_cast<uint8_t *>(memory_block->bock_parameter()) + (pos + data_part - memory_block->data_length()), data + data_part, part - data_part);
+            }
+            data += part;
+            offset += part;
+            len -= part;
+        }
+        block_offset += memory_block->data_length() + sizeof(MemoryBlockParams_t);
+    }
+}
+
+uint32_t MemoryManager::layout_hash(void)
+{
+    uint32_t layout[3] = {MEMORY_HEADER_FORMAT, sizeof(MemoryManagerHeader_t), sizeof(MemoryBlockParams_t)};
+    uint32_t hash = MemoryCrc_crc32(reinterpret_cast<uint8_t *>(layout), sizeof(layout));
+
+    for (uint16_t i = 0; i < m_memory_block_list.size(); i++)
+    {
+        layout[0] = m_memory_block_list[i].data_length();
+        layout[1] = m_memory_block_state_list[i].write_flag;
+        layout[2] = m_memory_block_list[i].record_size();
+        hash = MemoryCrc_crc32(reinterpret_cast<uint8_t *>(layout), sizeof(layout), hash);
+    }
+    return hash;
+}
+
+#if MEMORRY_FACTORY_IMAGE_ENABLED == true
+bool MemoryManager::write_factory_image(void)
+{
+    MemoryAddress_t size = image_size();
+    MemoryAddress_t offset = 0;
+    MemoryManagerBlock *memory_block;
+    uint8_t *staging = NULL;
+    const uint8_t *image = NULL;
+    bool ret = true;
+
+    /* An image generated at build time is only used if it matches this configuration */
+    if (m_factory_image != NULL)
+    {
+        if (factory_image_valid(m_factory_image, m_factory_image_size))
+        {
+            image = m_factory_image;
+        }
+        else
+        {
+            DBIF_LOG_ERROR("Factory Image does not match, build the Default Image");
+        }
+    }
+
+    if (image == NULL)
+    {
+        ret = (size <= MEMORRY_BULK_READ_MAX_SIZE);
+        if (ret)
+        {
+            staging = new (std::nothrow) uint8_t[factory_image_size()];
+            ret = (staging != NULL);
+        }
+        if (ret)
+        {
+            /* The staged image passes the same check, nothing corrupted is written */
+            factory_image(staging, factory_image_size());
+            image = staging;
+            ret = factory_image_valid(image, factory_image_size());
+        }
+        else if (size <= MEMORRY_BULK_READ_MAX_SIZE)
+        {
+            DBIF_LOG_ERROR("No staging buffer for the Factory Image, Size: %i", size);
+        }
+    }
+
+    if (ret)
+    {
+        DBIF_LOG_INFO(".... Factory Image: %i Bytes ....", size);
+        ret = (m_memory_interface->write(const_cast<uint8_t *>(image), 0, size) == size);
+        m_stats.written(MEMORY_HEADER_ENTRY, size, ret);
+        ret = ret && write_to_memory();
+    }
+
+    for (uint16_t i = 0; (i < m_memory_block_list.size()) && ret; i++)
+    {
+        memory_block = &m_memory_block_list[i];
+
+        copy_data(const_cast<uint8_t *>(&image[offset]), memory_block->get_data(MemoryManagerType_e::MEMORY_DATA), memory_block->data_length());
+        copy_data(const_cast<uint8_t *>(&image[offset]), memory_block->get_data(MemoryManagerType_e::USER_DATA), memory_block->data_length());
+        offset += memory_block->data_length();
+
+        memcpy(memory_block->bock_parameter(), &image[offset], sizeof(MemoryBlockParams_t));
+        memory_block->reset_block_params_update();
+        offset += sizeof(MemoryBlockParams_t);
+
+        m_memory_block_state_list[i].loaded = true;
+        m_memory_block_state_list[i].ring_ready = false;
+    }
+
+    delete[] staging;
+    return ret;
+}
+
+bool MemoryManager::factory_image_valid(const uint8_t *image, MemoryAddress_t size)
+{
+    MemoryManagerHeader_t header;
+    MemoryFactoryImageTrailer_t trailer;
+    bool ret = (size == factory_image_size());
+
+    if (ret)
+    {
+        memcpy(&header, image, sizeof(header));
+        memcpy(&trailer, &image[image_size()], sizeof(trailer));
+        ret = (trailer.magic == MEMORY_FACTORY_IMAGE_MAGIC) &&
+              (trailer.layout_hash == layout_hash()) &&
+              (trailer.image_crc == MemoryCrc_crc32(image, image_size())) &&
+              (header.version == m_current_version);
+    }
+    return ret;
+}
+#endif
+
+void MemoryManager::load_defaults(uint16_t entry_idx)
+{
+    MemoryManagerBlock *memory_block = &m_memory_block_list[entry_idx];
+
+    if (memory_block->default_data() != NULL)
+    {
+        copy_data(memory_block->default_data(), memory_block->get_data(MemoryManagerType_e::MEMORY_DATA), memory_block->data_length());
+        copy_data(memory_block->default_data(), memory_block->get_data(MemoryManagerType_e::USER_DATA), memory_block->data_length());
+    }
+    else
+    {
+        memset(memory_block->get_data(MemoryManagerType_e::MEMORY_DATA), 0x00, memory_block->data_length());
+        memset(memory_block->get_data(MemoryManagerType_e::USER_DATA), 0x00, memory_block->data_length());
+    }
+}
+
+bool MemoryManager::restore_defaults(uint16_t entry_idx)
+{
+    MemoryManagerBlock *memory_block;
+    bool written = true;
+
+    if ((entry_idx == MEMORY_HEADER_ENTRY) || (entry_idx >= m_memory_block_list.size()))
+    {
+        DBIF_LOG_ERROR("Invalid Index");
+        return false;
+    }
+
+    wait_io();
+    memory_block = get_block(entry_idx);
+    m_memory_block_state_list[entry_idx].pending = false;
+    m_memory_block_state_list[entry_idx].ring_ready = false;
+
+#if MEMORRY_LAZY_DEFAULTS_ENABLED == true
+    if (memory_block->status() == MemoryManagerStatus_e::STATUS_DEFAULT)
+    {
+        /* Memory holds the tombstone already, only the user data may differ */
+        copy_data(memory_block->get_data(MemoryManagerType_e::MEMORY_DATA), memory_block->user_data(), memory_block->data_length());
+    }
+    else
+    {
+        load_defaults(entry_idx);
+        memory_block->status(MemoryManagerStatus_e::STATUS_DEFAULT);
+        written = write_block_parameter(entry_idx);
+        m_memory_block_state_list[entry_idx].uncommitted = true;
+    }
+#else
+    if (memory_block->default_data() != NULL)
+    {
+        copy_data(memory_block->default_data(), memory_block->user_data(), memory_block->data_length());
+    }
+    else
+    {
+        memset(memory_block->user_data(), 0x00, memory_block->data_length());
+    }
+
+    /* Written only if the memory differs from the defaults */
+    write_block(entry_idx, MemoryBlockWrite_e::WRITE_ALL_BLOCKS, MemoryManagerType_e::USER_DATA, written);
+#endif
+
+    publish(EVENT_DEFAULTS_RESTORED, entry_idx);
+    return written;
+}
+
+#if MEMORRY_LAZY_DEFAULTS_ENABLED == true
+bool MemoryManager::write_lazy_defaults(void)
+{
+    bool ret = true;
+
+    for (uint16_t i = 1; i < m_memory_block_list.size(); i++)
+    {
+        load_defaults(i);
+        m_memory_block_list[i].status(MemoryManagerStatus_e::STATUS_DEFAULT);
+        ret = write_block_parameter(i) && ret;
+    }
+    return ret;
+}
+#endif
+
+void MemoryManager::mark_unclean(void)
+{
+    if (get_block(MEMORY_HEADER_ENTRY)->user_data<MemoryManagerHeader_t>()->shutdown != MemoryManagerStatus_e::STATUS_NOT_OK)
+    {
+        /* Data changed after shutdown(), the clean marker is no longer valid */
+        write_header(MemoryManagerStatus_e::STATUS_NOT_OK, false);
+    }
+}
+
+MemoryManagerBlock *MemoryManager::ring_log(uint16_t entry_idx)
+{
+    MemoryManagerBlock *memory_block = NULL;
+
+    if ((entry_idx != MEMORY_HEADER_ENTRY) && (entry_idx < m_memory_block_list.size()) &&
+        (m_memory_block_list[entry_idx].record_capacity() > 0))
+    {
+        memory_block = get_block(entry_idx);
+        if (m_memory_block_state_list[entry_idx].ring_ready == false)
+        {
+            ring_recover(entry_idx);
+        }
+    }
+    return memory_block;
+}
+
+void MemoryManager::ring_recover(uint16_t entry_idx)
+{
+    MemoryManagerBlock *memory_block = &m_memory_block_list[entry_idx];
+    MemoryBlockState_t *state = &m_memory_block_state_list[entry_idx];
+    uint16_t capacity = memory_block->record_capacity();
+    uint16_t low = 0, high = capacity - 1u, mid;
+    uint32_t first_seq, seq;
+
+    state->ring_head = 0;
+    state->ring_count = 0;
+    state->ring_seq = 1;
+    state->ring_ready = true;
+
+    if (ring_slot_valid(memory_block, 0, first_seq) == false)
+    {
+        /* Empty log, or slot 0 was torn after the log wrapped around */
+        if (ring_slot_valid(memory_block, capacity - 1u, seq))
+        {
+            state->ring_count = capacity - 1u;
+            state->ring_seq = seq + 1u;
+        }
+        return;
+    }
+
+    /* The slots from 0 up to the newest record hold consecutive sequence numbers */
+    while (low < high)
+    {
+        mid = low + (high - low + 1u) / 2u;
+        if (ring_slot_valid(memory_block, mid, seq) && (seq == first_seq + mid))
+        {
+            low = mid;
+        }
+        else
+        {
+            high = mid - 1u;
+        }
+    }
+
+    state->ring_head = (low + 1u) % capacity;
+    state->ring_seq = first_seq + low + 1u;
+    if (first_seq == 1u)
+    {
+        state->ring_count = low + 1u;
+    }
+    else
+    {
+        /* Wrapped, the slot at the head may have been torn while being overwritten */
+        state->ring_count = ring_slot_valid(memory_block, state->ring_head, seq) ? capacity : (capacity - 1u);
+    }
+    DBIF_LOG_DEBUG_0("Ring Log %i: Head %i, %i Records", entry_idx, state->ring_head, state->ring_count);
+}
+
+bool MemoryManager::ring_slot_valid(MemoryManagerBlock *block, uint16_t slot, uint32_t &seq)
+{
+    uint8_t *slot_data = block->eeprom_data() + slot * (sizeof(MemoryRingRecord_t) + block->record_size());
+    MemoryRingRecord_t header;
+    uint32_t crc;
+
+    memcpy(&header, slot_data, sizeof(header));
+    crc = MemoryCrc_crc32(reinterpret_cast<uint8_t *>(&header.seq), sizeof(header.seq));
+    crc = MemoryCrc_crc32(slot_data + sizeof(header), block->record_size(), crc);
+
+    seq = ((header.seq != 0) && (crc == header.crc)) ? header.seq : 0;
+    return (seq != 0);
+}
+
+bool MemoryManager::header_is_clean(void)
+{
+    MemoryManagerHeader_t *header = get_block(MEMORY_HEADER_ENTRY)->user_data<MemoryManagerHeader_t>();
+    uint32_t crc = MemoryCrc_crc32(reinterpret_cast<uint8_t *>(header), offsetof(MemoryManagerHeader_t, header_crc));
+
+    return (crc == header->header_crc) &&
+           (header->format == MEMORY_HEADER_FORMAT) &&
+           (header->shutdown == MemoryManagerStatus_e::STATUTS_OK) &&
+           (m_current_version <= header->version);
+}
+
+MemoryManagerStatus_e MemoryManager::load_verified_memory(void)
+{
+    if (m_load_mode == MemoryManagerLoad_e::LOAD_ALL_BLOCKS)
+    {
+        read_all();
+    }
+    else
+    {
+        for (uint16_t i = 1; i < m_memory_block_state_list.size(); i++)
+        {
+            m_memory_block_state_list[i].loaded = false;
+            m_memory_block_state_list[i].ring_ready = false;
+        }
+        m_prefetch_idx = 1;
+    }
+    return MemoryManagerStatus_e::STATUTS_OK;
+}
+
+bool MemoryManager::write_header(MemoryManagerStatus_e shutdown, bool new_generation)
+{
+    MemoryManagerHeader_t *header = get_block(MEMORY_HEADER_ENTRY)->user_data<MemoryManagerHeader_t>();
+
+    if (new_generation)
+    {
+        header->generation++;
+    }
+    header->format = MEMORY_HEADER_FORMAT;
+    header->shutdown = shutdown;
+    header->header_crc = MemoryCrc_crc32(reinterpret_cast<uint8_t *>(header), offsetof(MemoryManagerHeader_t, header_crc));
+
+    return write_entry(MEMORY_HEADER_ENTRY);
+}
 
 void MemoryManager::set_memory_verification(MemoryManagerStatus_e status)
 {
@@ -364,6 +1541,7 @@ MemoryDataCompare_e MemoryManager::compare_entry(uint16_t entry_idx,MemoryManage
     {
         block = m_memory_block_list[entry_idx];
         ret = compare_data(block.eeprom_data(),block.get_data(data_type),block.data_length());
+        m_stats.compared(entry_idx, block.data_length());
         
     }
     return ret;
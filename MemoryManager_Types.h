@@ -8,14 +8,28 @@
 
 #include "stdio.h"
 #include "string.h"
+#include "stddef.h"
 #include "MemoryCrc/MemoryCrc_Types.h"
 
+/**
+ * @brief Offset, length or size within a Memory.
+ */
+typedef uint32_t MemoryAddress_t;
+
 /**
  * @def MEMORY_HEADER_ENTRY
  * @brief Identifier for the memory header entry.
  */
 #define MEMORY_HEADER_ENTRY 0u
 
+/**
+ * @brief Request types encoded in the upper bits of an asynchronous Memory request tag,
+ *        the lower 16 bits hold the block index.
+ */
+#define MEMORY_IO_DATA      0x00000000u
+#define MEMORY_IO_PARAMETER 0x00010000u
+#define MEMORY_IO_COMMIT    0x00020000u
+
 /**
  * @enum MemoryDataCompare_e
  * @brief Enumerates the possible results of a memory data comparison.
@@ -36,6 +50,7 @@ enum MemoryManagerStatus_e
     STATUTS_OK = 0x33,     /**< MemoryManager block status: OK. */
     STATUS_NOT_OK = 0x22,  /**< MemoryManager block status: Not OK. */
     STATUS_UNINIT = 0x11,  /**< MemoryManager block status: Uninitialized. */
+    STATUS_DEFAULT = 0x44, /**< MemoryManager block status: Holds its default data, the data bytes in memory are not written. */
     STATUS_ERROR = 0x00    /**< MemoryManager block status: Error. */
 };
 
@@ -63,6 +78,30 @@ enum MemoryBlockWrite_e
     WRITE_ALL_BLOCKS            /**< Write mode: All blocks. */
 };
 
+/**
+ * @enum MemoryManagerLoad_e
+ * @brief Enumerates the possible strategies to load the blocks from memory.
+ */
+enum MemoryManagerLoad_e
+{
+    LOAD_ALL_BLOCKS = 0x00,         /**< All blocks are read during begin(). */
+    LOAD_ON_DEMAND,                 /**< A block is read on its first access. */
+    LOAD_ON_DEMAND_PREFETCH         /**< A block is read on its first access, loop() loads the remaining blocks one by one. */
+};
+
+/**
+ * @enum MemoryBlockPriority_e
+ * @brief Enumerates the priority classes which define the order blocks are flushed in.
+ */
+enum MemoryBlockPriority_e
+{
+    PRIORITY_CRITICAL = 0x00,   /**< Flushed first, e.g. calibration or safety state. */
+    PRIORITY_HIGH,              /**< Flushed after critical blocks. */
+    PRIORITY_NORMAL,            /**< Default priority. */
+    PRIORITY_LOW,               /**< Flushed last, e.g. cosmetic settings. */
+    PRIORITY_COUNT
+};
+
 /**
  * @struct MemoryBlockParams_t
  * @brief Holds parameters for a MemoryManager block.
@@ -76,6 +115,43 @@ struct MemoryBlockParams_t
     MemoryCrcType_e crc_type; /**< Type of CRC used (if enabled). */
 #endif
     uint32_t cycle_time; /**< Cycle time for the block (if applicable). */
+    uint32_t crc;        /**< CRC32 of the block data and the previous parameters, must stay the last member. */
+};
+
+/**
+ * @struct MemoryBlockField_t
+ * @brief Describes one field of a block for field-granular change tracking.
+ */
+struct MemoryBlockField_t
+{
+    uint32_t offset;                /**< Offset of the field in the block data. */
+    uint32_t size;                  /**< Size of the field in bytes. */
+    MemoryBlockWrite_e write_flag;  /**< Write policy of the field (WRITE_ON_CHANGE, WRITE_CYCLIC, WRITE_ON_SHUTDOWN). */
+    uint32_t cycle_time_ms;         /**< Minimum time between two writes of a WRITE_CYCLIC field. */
+};
+
+/**
+ * @def MEMORY_FIELD
+ * @brief Descriptor of a member of the block struct, e.g. MEMORY_FIELD(Config_t, brightness, WRITE_ON_CHANGE).
+ */
+#define MEMORY_FIELD(type, member, write_flag) \
+    MemoryBlockField_t{offsetof(type, member), sizeof(((type *)0)->member), (write_flag), 0u}
+
+/**
+ * @def MEMORY_FIELD_CYCLIC
+ * @brief Descriptor of a member written at most every cycle_time_ms.
+ */
+#define MEMORY_FIELD_CYCLIC(type, member, cycle_time_ms) \
+    MemoryBlockField_t{offsetof(type, member), sizeof(((type *)0)->member), MemoryBlockWrite_e::WRITE_CYCLIC, (cycle_time_ms)}
+
+/**
+ * @struct MemoryRingRecord_t
+ * @brief Header of one record slot of a ring log block, followed by the record.
+ */
+struct MemoryRingRecord_t
+{
+    uint32_t seq;   /**< Sequence number, counts from 1, 0 marks an empty slot. */
+    uint32_t crc;   /**< CRC32 of seq and the record. */
 };
 
 /**
@@ -99,7 +175,11 @@ public:
                            m_default_data(nullptr), 
                            m_data_length(0),
                            m_block_params{MemoryManagerStatus_e::STATUS_UNINIT, MemoryBlockWrite_e::WRITE_NOT_CONFIGURED},
-                           m_block_params_update(false)
+                           m_block_params_update(false),
+                           m_priority(MemoryBlockPriority_e::PRIORITY_NORMAL),
+                           m_fields(nullptr),
+                           m_field_count(0),
+                           m_record_size(0)
     {
     }
 
@@ -112,18 +192,25 @@ public:
      * @param eeprom_data Pointer to EEPROM data.
      * @param data_length Length of data.
      * @param default_data Pointer to default data.
+     * @param write_flag Write mode of the block.
+     * @param priority Priority class defining the flush order.
      */
     MemoryManagerBlock(uint8_t *user_data, 
                        uint8_t *eeprom_data, 
                        uint32_t data_length,
                        uint8_t *default_data = nullptr, 
-                       MemoryBlockWrite_e write_flag = MemoryBlockWrite_e::WRITE_NOT_CONFIGURED) : 
+                       MemoryBlockWrite_e write_flag = MemoryBlockWrite_e::WRITE_NOT_CONFIGURED,
+                       MemoryBlockPriority_e priority = MemoryBlockPriority_e::PRIORITY_NORMAL) : 
                                                m_user_data(user_data),
                                                m_eeprom_data(eeprom_data),
                                                m_default_data(default_data),
                                                m_data_length(data_length),
                                                m_block_params{MemoryManagerStatus_e::STATUS_UNINIT, write_flag},
-                                               m_block_params_update(false)
+                                               m_block_params_update(false),
+                                               m_priority(priority),
+                                               m_fields(nullptr),
+                                               m_field_count(0),
+                                               m_record_size(0)
     {
     }
 
@@ -238,7 +325,72 @@ public:
      *
      * @param write_flag Write flag of the MemoryManager block.
      */
-	void write_flag(MemoryBlockWrite_e write_flag) { m_block_params_update = true;}
+	void write_flag(MemoryBlockWrite_e write_flag) { m_block_params_update = true;
+	                                                 m_block_params.write_flag = write_flag; }
+
+    /**
+     * @brief Getter for the priority class of the block.
+     *
+     * @return Priority class of the block.
+     */
+    MemoryBlockPriority_e priority(void) const { return m_priority; }
+
+    /**
+     * @brief Setter for the priority class of the block.
+     *
+     * @param priority Priority class of the block.
+     */
+    void priority(MemoryBlockPriority_e priority) { m_priority = priority; }
+
+    /**
+     * @brief Sets the field layout, changes are then tracked and written per field.
+     *
+     * Bytes not covered by a field are written together with the whole
+     * block by write_all() and shutdown(), and when defaults are restored.
+     *
+     * @param fields Array of field descriptors, has to stay valid.
+     * @param count Number of fields.
+     */
+    void fields(const MemoryBlockField_t *fields, uint16_t count) { m_fields = fields;
+                                                                    m_field_count = (fields != nullptr) ? count : 0; }
+
+    /**
+     * @brief Getter for the field descriptors.
+     *
+     * @return Pointer to the field descriptors, nullptr if the block has no field layout.
+     */
+    const MemoryBlockField_t *fields(void) const { return m_fields; }
+
+    /**
+     * @brief Getter for the number of fields.
+     *
+     * @return Number of fields, 0 if the block is tracked as a whole.
+     */
+    uint16_t field_count(void) const { return m_field_count; }
+
+    /**
+     * @brief Turns the block into a ring log of fixed size records, see MemoryManager::append().
+     *
+     * The block data holds record_capacity() slots of a MemoryRingRecord_t
+     * followed by the record. The default data has to be zero (or NULL).
+     *
+     * @param record_size Size of one record in bytes, 0 for a regular block.
+     */
+    void record_size(uint16_t record_size) { m_record_size = record_size; }
+
+    /**
+     * @brief Getter for the record size.
+     *
+     * @return Size of one record, 0 if the block is no ring log.
+     */
+    uint16_t record_size(void) const { return m_record_size; }
+
+    /**
+     * @brief Getter for the number of record slots of a ring log.
+     *
+     * @return Number of records the block can hold, 0 if the block is no ring log.
+     */
+    uint16_t record_capacity(void) const { return (m_record_size > 0) ? (m_data_length / (sizeof(MemoryRingRecord_t) + m_record_size)) : 0; }
 
     /**
      * @brief Getter for the block parameters.
@@ -320,6 +472,182 @@ private:
     uint32_t m_data_length;             /**< Length of data. */
     MemoryBlockParams_t m_block_params; /**< Boolean value indicating whether the data has been initialized. */
     bool m_block_params_update;
+    MemoryBlockPriority_e m_priority;   /**< Priority class defining the flush order. */
+    const MemoryBlockField_t *m_fields; /**< Optional field layout. */
+    uint16_t m_field_count;             /**< Number of fields. */
+    uint16_t m_record_size;             /**< Record size of a ring log, 0 for a regular block. */
+};
+
+/**
+ * @brief Struct limiting the work done by a single MemoryManager::loop() call.
+ *
+ * A value of 0 means unlimited. The budget is checked after each block, so
+ * a single block is always processed completely.
+ */
+struct MemoryManagerBudget_t
+{
+    uint32_t time_us;   /**< Maximum time spent in loop() in microseconds. */
+    uint32_t bytes;     /**< Maximum number of bytes written to memory. */
+};
+
+/**
+ * @brief Struct configuring when loop() commits written blocks to memory.
+ *
+ * Written blocks are handed to Memory::write() right away, only the commit is
+ * delayed. All values 0 (default) commit after every pass that wrote a block.
+ */
+struct MemoryManagerCommitPolicy_t
+{
+    uint32_t min_interval_ms;   /**< Minimum time between two commits. */
+    uint32_t max_staleness_ms;  /**< Maximum time written data may stay uncommitted (0: no limit). */
+    uint32_t max_dirty_bytes;   /**< Uncommitted bytes which force a commit (0: no limit). */
+};
+
+/**
+ * @enum MemoryBlockTemperature_e
+ * @brief Enumerates the write frequency classes of a block.
+ */
+enum MemoryBlockTemperature_e
+{
+    BLOCK_COLD = 0x00,  /**< Rarely written, changes are persisted immediately. */
+    BLOCK_HOT           /**< Frequently written, changes are batched. */
+};
+
+/**
+ * @brief Struct configuring the hot/cold classification of WRITE_ON_CHANGE blocks.
+ *
+ * Each change of a block adds one to its write rate, which halves every
+ * half_life_ms. A block becomes hot at hot_threshold and cold again below
+ * cold_threshold, which has to be lower (0: half of hot_threshold). Changes of hot blocks are written at most every
+ * hot_max_delay_ms, a written cold block is committed in the same pass.
+ * half_life_ms 0 (default) disables the classification.
+ */
+struct MemoryManagerHeatPolicy_t
+{
+    uint32_t half_life_ms;      /**< Half-life of the write rate. */
+    uint16_t hot_threshold;     /**< Write rate (changes per half-life) at which a block becomes hot. */
+    uint32_t hot_max_delay_ms;  /**< Maximum time a change of a hot block is deferred. */
+    uint16_t cold_threshold;    /**< Write rate below which a hot block becomes cold again (default 0: half of hot_threshold). */
+};
+
+/**
+ * @brief Struct representing the runtime state the MemoryManager keeps for each block.
+ */
+struct MemoryBlockState_t
+{
+    bool loaded;                /**< Block data has been read from memory. */
+    bool hot;                   /**< Block is classified as BLOCK_HOT. */
+    bool pending;               /**< A change of the block is deferred. */
+    uint16_t write_rate;        /**< Decayed write rate, 8 fractional bits. */
+    uint32_t rate_updated_ms;   /**< Time the write rate was last decayed. */
+    uint32_t pending_since_ms;  /**< Time the deferred change was detected. */
+    bool change_reported;       /**< A change has been reported by block_changed() since the last check of defer_write(). */
+    bool uncommitted;           /**< User data written to memory but not committed yet. */
+    uint16_t field_time_idx;    /**< First write time of the block's fields in the field time list. */
+    bool ring_ready;            /**< Head of the ring log has been located in the loaded data. */
+    uint16_t ring_head;         /**< Slot the next record of the ring log is written to. */
+    uint16_t ring_count;        /**< Number of valid records in the ring log. */
+    uint32_t ring_seq;          /**< Sequence number of the next record. */
+    bool in_transaction;        /**< Change reported while a transaction is open, part of the transaction. */
+    bool journaled;             /**< Written to the journal by commit_transaction(), applied in place afterwards. */
+    MemoryBlockWrite_e write_flag;  /**< Write flag configured by add_block(), replaces invalid parameters read from memory. */
+    uint8_t loading;            /**< Outstanding reads of an asynchronous load (coroutine load()). */
+    bool load_ok;               /**< Reads of the asynchronous load succeeded, afterwards: block parameters valid. */
+};
+
+/**
+ * @enum MemoryManagerEvent_e
+ * @brief Enumerates the events published to subscribers of a MemoryManager.
+ */
+enum MemoryManagerEvent_e
+{
+    EVENT_BLOCK_CHANGED = 0x00,     /**< The application reported a change of the block. */
+    EVENT_BLOCK_LOADED,             /**< The block has been read from memory and is valid. */
+    EVENT_BLOCK_PERSISTED,          /**< A change of the block has been committed. */
+    EVENT_DEFAULTS_RESTORED,        /**< Default data has been written (MEMORY_HEADER_ENTRY: all blocks). */
+    EVENT_VERIFICATION_FAILED       /**< The parameters of the block read from memory are invalid. */
+};
+
+/**
+ * @def MEMORY_EVENT_MASK
+ * @brief Subscription mask bit of a MemoryManagerEvent_e.
+ */
+#define MEMORY_EVENT_MASK(event) (1u << (event))
+#define MEMORY_EVENT_MASK_ALL    0xFFFFFFFFu
+
+/**
+ * @brief Event callback, invoked synchronously from the MemoryManager method raising the event.
+ */
+typedef void (*MemoryManagerEventCallback_t)(void *context, MemoryManagerEvent_e event, uint16_t entry_idx);
+
+/**
+ * @brief Struct representing a subscriber of MemoryManager events.
+ */
+struct MemoryManagerSubscriber_t
+{
+    uint32_t mask;                          /**< MEMORY_EVENT_MASK() of the subscribed events. */
+    MemoryManagerEventCallback_t callback;  /**< Function invoked for each event. */
+    void *context;                          /**< Passed to the callback. */
+};
+
+/**
+ * @enum MemoryManagerWait_e
+ * @brief Enumerates the conditions a coroutine can wait for.
+ */
+enum MemoryManagerWait_e
+{
+    WAIT_FLUSH = 0x00,  /**< The changed blocks have been written to memory. */
+    WAIT_SYNC,          /**< The changed blocks have been written and committed. */
+    WAIT_LOAD           /**< A block has been read from memory. */
+};
+
+/**
+ * @brief Resumes a suspended coroutine, the handle is its address.
+ */
+typedef void (*MemoryManagerResume_t)(void *handle);
+
+/**
+ * @brief Struct representing a coroutine suspended on a MemoryManager condition.
+ */
+struct MemoryManagerWaiter_t
+{
+    MemoryManagerWait_e kind;       /**< Condition the coroutine waits for. */
+    uint16_t entry_idx;             /**< Block of WAIT_LOAD. */
+    uint32_t pass;                  /**< loop() pass which has to be completed (WAIT_FLUSH, WAIT_SYNC). */
+    MemoryManagerResume_t resume;   /**< Function resuming the coroutine. */
+    void *handle;                   /**< Address of the coroutine. */
+    bool *result;                   /**< Receives the result before the coroutine is resumed. */
+};
+
+/**
+ * @def MEMORY_JOURNAL_MAGIC
+ * @brief Marks a transaction journal which has not been applied yet ("JRNL").
+ */
+#define MEMORY_JOURNAL_MAGIC 0x4A524E4Cu
+
+/**
+ * @brief Struct representing the header of the transaction journal stored behind the last block.
+ *
+ * The header is followed by count entries, each a MemoryJournalEntry_t and
+ * the new user data of the block.
+ */
+struct MemoryJournalHeader_t
+{
+    uint32_t magic;     /**< MEMORY_JOURNAL_MAGIC while the journal has to be replayed. */
+    uint16_t count;     /**< Number of entries. */
+    uint16_t reserved;
+    uint32_t length;    /**< Length of all entries in bytes. */
+    uint32_t crc;       /**< CRC32 of the entries and the previous header fields, must stay the last member. */
+};
+
+/**
+ * @brief Struct representing one block of the transaction journal.
+ */
+struct MemoryJournalEntry_t
+{
+    uint16_t entry_idx; /**< Index of the block. */
+    uint16_t reserved;
+    uint32_t length;    /**< Length of the user data following the entry. */
 };
 
 /**
@@ -378,6 +706,17 @@ union MemoryManagerVersion_t
     bool operator<=(const MemoryManagerVersion_t &other) const {return u32 <= other.u32; }
 };
 
+/**
+ * @def MEMORY_HEADER_FORMAT
+ * @brief Marks the layout of MemoryManagerHeader_t, images with another header layout get their defaults written.
+ */
+#define MEMORY_HEADER_FORMAT 0x48445234u /* "HDR4", block parameters with CRC */
+
+/**
+ * @def MEMORY_HEADER_FORMAT_V3
+ * @brief Header layout of the previous version, same header but block parameters without CRC. Migrated by begin().
+ */
+#define MEMORY_HEADER_FORMAT_V3 0x48445233u /* "HDR3" */
 
 /**
  * @brief Struct representing the header of a MemoryManager.
@@ -390,6 +729,26 @@ struct MemoryManagerHeader_t
 #if MEMORRY_CRC_ENABLED == true
     uint32_t crc; /**< CRC value of the MemoryManager. */
 #endif
+    uint32_t format;                /**< MEMORY_HEADER_FORMAT, the block offsets depend on the header size. */
+    uint32_t generation;            /**< Image generation, incremented on every begin(). */
+    MemoryManagerStatus_e shutdown; /**< STATUTS_OK after a clean shutdown(), STATUS_NOT_OK while running. */
+    uint32_t header_crc;            /**< CRC32 of all previous header fields, must stay the last member. */
+};
+
+/**
+ * @def MEMORY_FACTORY_IMAGE_MAGIC
+ * @brief Marks the trailer of a factory image.
+ */
+#define MEMORY_FACTORY_IMAGE_MAGIC 0x46494D47u /* "FIMG" */
+
+/**
+ * @brief Struct representing the trailer appended to a factory image by MemoryManager::factory_image().
+ */
+struct MemoryFactoryImageTrailer_t
+{
+    uint32_t magic;         /**< MEMORY_FACTORY_IMAGE_MAGIC. */
+    uint32_t layout_hash;   /**< CRC32 over the block layout the image was built for. */
+    uint32_t image_crc;     /**< CRC32 over the image without the trailer. */
 };
 
 /**
@@ -400,6 +759,12 @@ struct MemoryManagerConfig_t
     MemoryManagerVersion_t version;     /**< Version of the MemoryManager. */
     MemoryManagerBlock *storage;        /**< Pointer to the storage of MemoryManagerBlocks. */
     uint16_t number_of_storage;         /**< Number of MemoryManagerBlocks in the storage. */
+    MemoryManagerLoad_e load_mode;      /**< Strategy to load the blocks from memory (default: LOAD_ALL_BLOCKS). */
+    MemoryManagerCommitPolicy_t commit_policy; /**< Coalescing of commits in loop() (default: commit immediately). */
+    MemoryManagerHeatPolicy_t heat_policy;     /**< Hot/cold classification of blocks (default: disabled). */
+    bool change_driven;                 /**< loop() only works after block_changed() (default: polls all blocks). */
+    const uint8_t *factory_image;       /**< Default image built with MemoryManager::factory_image() (default: built at runtime). */
+    MemoryAddress_t factory_image_size; /**< Size of factory_image in bytes. */
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,288 @@
+#ifndef MEMORY_SNAPSHOT_H
+#define MEMORY_SNAPSHOT_H
+
+#include <stdint.h>
+#include <string.h>
+#include "../MemoryManager_Feature.h"
+#include "../MemoryCrc/MemoryCrc.h"
+
+/**
+ * @def MEMORY_SNAPSHOT_MAGIC
+ * @brief First word of a snapshot ("MSNP").
+ */
+#define MEMORY_SNAPSHOT_MAGIC       0x4D534E50u
+#define MEMORY_SNAPSHOT_END_MAGIC   0x53454E44u /* "SEND" */
+#define MEMORY_SNAPSHOT_FORMAT      1u
+
+/*
+ * Binary layout, little endian, see tools/memory_snapshot.py:
+ *
+ *   MemorySnapshotHeader_t
+ *   MemorySnapshotDirEntry_t[block_count], uint32_t crc of the directory
+ *   chunks: MemorySnapshotChunk_t, payload, uint32_t crc of chunk header and payload
+ *   MemorySnapshotTrailer_t
+ *
+ * The chunk payloads concatenated are the memory image (data followed by
+ * MemoryBlockParams_t of each block, the header block first), so an import
+ * is one sequential write.
+ */
+
+/**
+ * @brief Struct representing the header of a snapshot.
+ */
+struct MemorySnapshotHeader_t
+{
+    uint32_t magic;         /**< MEMORY_SNAPSHOT_MAGIC. */
+    uint16_t format;        /**< MEMORY_SNAPSHOT_FORMAT. */
+    uint16_t block_count;   /**< Number of blocks including the header block. */
+    uint32_t version;       /**< MemoryManagerVersion_t of the image. */
+    uint32_t image_size;    /**< Size of the memory image in bytes. */
+    uint16_t chunk_size;    /**< Maximum payload of a chunk. */
+    uint16_t params_size;   /**< sizeof(MemoryBlockParams_t) of the exporting target. */
+    uint32_t crc;           /**< CRC32 of the previous fields, must stay the last member. */
+};
+
+/**
+ * @brief Struct representing one block of the snapshot directory.
+ */
+struct MemorySnapshotDirEntry_t
+{
+    uint32_t offset;        /**< Offset of the block in the image. */
+    uint32_t length;        /**< Length of the block data, the parameters follow. */
+    uint32_t crc;           /**< CRC32 of the block data and parameters. */
+};
+
+/**
+ * @brief Struct representing the header of a chunk of the image.
+ */
+struct MemorySnapshotChunk_t
+{
+    uint32_t offset;        /**< Offset of the payload in the image. */
+    uint32_t length;        /**< Length of the payload. */
+};
+
+/**
+ * @brief Struct representing the end of a snapshot.
+ */
+struct MemorySnapshotTrailer_t
+{
+    uint32_t magic;         /**< MEMORY_SNAPSHOT_END_MAGIC. */
+    uint32_t image_crc;     /**< CRC32 of the complete image. */
+};
+
+/**
+ * @class MemorySnapshotSink
+ * @brief Receives the bytes of an exported snapshot, e.g. a file, a socket or a UART.
+ */
+class MemorySnapshotSink
+{
+public:
+    virtual bool write(const uint8_t *data_ptr, uint32_t len) = 0;
+};
+
+/**
+ * @class MemorySnapshotSource
+ * @brief Provides the bytes of a snapshot to import.
+ */
+class MemorySnapshotSource
+{
+public:
+    /**
+     * @return The number of bytes read, less than len only at the end of the snapshot.
+     */
+    virtual uint32_t read(uint8_t *data_ptr, uint32_t len) = 0;
+};
+
+/**
+ * @class MemorySnapshotWriter
+ * @brief Encodes a snapshot into a sink, only one chunk is buffered.
+ */
+class MemorySnapshotWriter
+{
+public:
+    MemorySnapshotWriter(MemorySnapshotSink &sink) : m_sink(&sink), m_fill(0), m_offset(0), m_directory_crc(0), m_image_crc(0), m_ok(true) {}
+
+    bool header(MemorySnapshotHeader_t &header)
+    {
+        header.magic = MEMORY_SNAPSHOT_MAGIC;
+        header.format = MEMORY_SNAPSHOT_FORMAT;
+        header.chunk_size = MEMORRY_SNAPSHOT_CHUNK_SIZE;
+        header.crc = MemoryCrc_crc32(reinterpret_cast<uint8_t *>(&header), sizeof(header) - sizeof(header.crc));
+        return emit(reinterpret_cast<uint8_t *>(&header), sizeof(header));
+    }
+
+    bool directory_entry(const MemorySnapshotDirEntry_t &entry)
+    {
+        m_directory_crc = MemoryCrc_crc32(reinterpret_cast<const uint8_t *>(&entry), sizeof(entry), m_directory_crc);
+        return emit(reinterpret_cast<const uint8_t *>(&entry), sizeof(entry));
+    }
+
+    bool directory_end(void)
+    {
+        return emit(reinterpret_cast<uint8_t *>(&m_directory_crc), sizeof(m_directory_crc));
+    }
+
+    /**
+     * @brief Appends bytes to the image, full chunks are written to the sink.
+     */
+    bool image(const uint8_t *data_ptr, uint32_t len)
+    {
+        uint32_t part;
+
+        m_image_crc = MemoryCrc_crc32(data_ptr, len, m_image_crc);
+        while ((len > 0) && m_ok)
+        {
+            part = ((MEMORRY_SNAPSHOT_CHUNK_SIZE - m_fill) < len) ? (MEMORRY_SNAPSHOT_CHUNK_SIZE - m_fill) : len;
+            memcpy(&m_chunk[m_fill], data_ptr, part);
+            m_fill += part;
+            data_ptr += part;
+            len -= part;
+            if (m_fill == MEMORRY_SNAPSHOT_CHUNK_SIZE)
+            {
+                flush();
+            }
+        }
+        return m_ok;
+    }
+
+    /**
+     * @brief Writes the last chunk and the trailer.
+     */
+    bool finish(void)
+    {
+        MemorySnapshotTrailer_t trailer = {MEMORY_SNAPSHOT_END_MAGIC, m_image_crc};
+
+        if (m_fill > 0)
+        {
+            flush();
+        }
+        return emit(reinterpret_cast<uint8_t *>(&trailer), sizeof(trailer));
+    }
+
+private:
+    void flush(void)
+    {
+        MemorySnapshotChunk_t chunk = {m_offset, m_fill};
+        uint32_t crc = MemoryCrc_crc32(reinterpret_cast<uint8_t *>(&chunk), sizeof(chunk));
+
+        crc = MemoryCrc_crc32(m_chunk, m_fill, crc);
+        emit(reinterpret_cast<uint8_t *>(&chunk), sizeof(chunk));
+        emit(m_chunk, m_fill);
+        emit(reinterpret_cast<uint8_t *>(&crc), sizeof(crc));
+        m_offset += m_fill;
+        m_fill = 0;
+    }
+
+    bool emit(const uint8_t *data_ptr, uint32_t len)
+    {
+        m_ok = m_ok && m_sink->write(data_ptr, len);
+        return m_ok;
+    }
+
+    MemorySnapshotSink *m_sink;
+    uint8_t m_chunk[MEMORRY_SNAPSHOT_CHUNK_SIZE];
+    uint32_t m_fill;
+    uint32_t m_offset;
+    uint32_t m_directory_crc;
+    uint32_t m_image_crc;
+    bool m_ok;
+};
+
+/**
+ * @class MemorySnapshotReader
+ * @brief Decodes and verifies a snapshot from a source, chunk by chunk.
+ */
+class MemorySnapshotReader
+{
+public:
+    MemorySnapshotReader(MemorySnapshotSource &source) : m_source(&source), m_image_size(0), m_offset(0), m_directory_crc(0), m_image_crc(0) {}
+
+    bool header(MemorySnapshotHeader_t &header)
+    {
+        bool ret = fetch(reinterpret_cast<uint8_t *>(&header), sizeof(header)) &&
+                   (header.magic == MEMORY_SNAPSHOT_MAGIC) &&
+                   (header.format == MEMORY_SNAPSHOT_FORMAT) &&
+                   (header.chunk_size <= MEMORRY_SNAPSHOT_CHUNK_SIZE) &&
+                   (header.crc == MemoryCrc_crc32(reinterpret_cast<uint8_t *>(&header), sizeof(header) - sizeof(header.crc)));
+        m_image_size = ret ? header.image_size : 0;
+        return ret;
+    }
+
+    bool directory_entry(MemorySnapshotDirEntry_t &entry)
+    {
+        bool ret = fetch(reinterpret_cast<uint8_t *>(&entry), sizeof(entry));
+
+        m_directory_crc = MemoryCrc_crc32(reinterpret_cast<uint8_t *>(&entry), sizeof(entry), m_directory_crc);
+        return ret;
+    }
+
+    bool directory_end(void)
+    {
+        uint32_t crc;
+
+        return fetch(reinterpret_cast<uint8_t *>(&crc), sizeof(crc)) && (crc == m_directory_crc);
+    }
+
+    /**
+     * @brief Returns true while image chunks are left.
+     */
+    bool remaining(void) { return m_offset < m_image_size; }
+
+    /**
+     * @brief Reads the next chunk of the image.
+     * @param payload Buffer of MEMORRY_SNAPSHOT_CHUNK_SIZE bytes.
+     * @param offset Receives the offset of the payload in the image.
+     * @param len Receives the length of the payload.
+     * @return False if the chunk is out of sequence or its CRC does not match.
+     */
+    bool chunk(uint8_t *payload, uint32_t &offset, uint32_t &len)
+    {
+        MemorySnapshotChunk_t chunk;
+        uint32_t crc;
+        bool ret;
+
+        ret = fetch(reinterpret_cast<uint8_t *>(&chunk), sizeof(chunk)) &&
+              (chunk.offset == m_offset) &&
+              (chunk.length > 0) && (chunk.length <= MEMORRY_SNAPSHOT_CHUNK_SIZE) &&
+              (chunk.offset + chunk.length <= m_image_size) &&
+              fetch(payload, chunk.length) &&
+              fetch(reinterpret_cast<uint8_t *>(&crc), sizeof(crc));
+
+        ret = ret && (crc == MemoryCrc_crc32(payload, chunk.length, MemoryCrc_crc32(reinterpret_cast<uint8_t *>(&chunk), sizeof(chunk))));
+        if (ret)
+        {
+            m_image_crc = MemoryCrc_crc32(payload, chunk.length, m_image_crc);
+            m_offset += chunk.length;
+            offset = chunk.offset;
+            len = chunk.length;
+        }
+        return ret;
+    }
+
+    /**
+     * @brief Reads the trailer and checks the CRC of the complete image.
+     */
+    bool finish(void)
+    {
+        MemorySnapshotTrailer_t trailer;
+
+        return (remaining() == false) &&
+               fetch(reinterpret_cast<uint8_t *>(&trailer), sizeof(trailer)) &&
+               (trailer.magic == MEMORY_SNAPSHOT_END_MAGIC) &&
+               (trailer.image_crc == m_image_crc);
+    }
+
+private:
+    bool fetch(uint8_t *data_ptr, uint32_t len)
+    {
+        return (m_source->read(data_ptr, len) == len);
+    }
+
+    MemorySnapshotSource *m_source;
+    uint32_t m_image_size;
+    uint32_t m_offset;
+    uint32_t m_directory_crc;
+    uint32_t m_image_crc;
+};
+
+#endif
@@ -0,0 +1,225 @@
+#ifndef MEMORY_STATS_H
+#define MEMORY_STATS_H
+
+#include <vector>
+#include "../MemoryManager_Feature.h"
+#include "../MemoryTimer/MemoryTimer.h"
+#include "../MemoryList/MemoryStaticList.h"
+
+/**
+ * @def MEMORY_STATS_HISTOGRAM_BUCKETS
+ * @brief Number of buckets of a timing histogram. Bucket n counts durations
+ *        of [2^n, 2^(n+1)) microseconds, the last bucket everything above.
+ */
+#ifndef MEMORY_STATS_HISTOGRAM_BUCKETS
+#define MEMORY_STATS_HISTOGRAM_BUCKETS 20u
+#endif
+
+/**
+ * @brief Logarithmic histogram of durations in microseconds.
+ */
+struct MemoryStatsHistogram_t
+{
+    uint32_t bucket[MEMORY_STATS_HISTOGRAM_BUCKETS]; /**< Number of samples per bucket. */
+    uint32_t count;                                  /**< Number of samples. */
+    uint32_t max_us;                                 /**< Longest duration. */
+    uint64_t total_us;                               /**< Sum of all durations. */
+
+    /**
+     * @brief Adds a duration to the histogram.
+     * @param duration_us Duration in microseconds.
+     */
+    void add(uint32_t duration_us)
+    {
+        uint8_t idx = 0;
+        for (uint32_t value = duration_us >> 1; (value != 0) && (idx < MEMORY_STATS_HISTOGRAM_BUCKETS - 1u); value >>= 1)
+        {
+            idx++;
+        }
+        bucket[idx]++;
+        count++;
+        total_us += duration_us;
+        max_us = (duration_us > max_us) ? duration_us : max_us;
+    }
+};
+
+/**
+ * @brief Counters of a single MemoryManager block.
+ */
+struct MemoryBlockStats_t
+{
+    uint32_t compares;      /**< Number of comparisons against the memory mirror. */
+    uint32_t bytes_compared;/**< Number of bytes compared. */
+    uint32_t writes;        /**< Number of Memory::write() calls. */
+    uint32_t bytes_written; /**< Number of bytes passed to Memory::write(). */
+    uint32_t failed_writes; /**< Number of failed Memory::write() calls. */
+};
+
+/**
+ * @brief Global counters of a MemoryManager.
+ */
+struct MemoryManagerStats_t
+{
+    uint32_t compares;              /**< Number of block comparisons. */
+    uint32_t bytes_compared;        /**< Number of bytes compared. */
+    uint32_t writes;                /**< Number of Memory::write() calls. */
+    uint32_t bytes_written;         /**< Number of bytes passed to Memory::write(). */
+    uint32_t failed_writes;         /**< Number of failed Memory::write() calls. */
+    uint32_t commits;               /**< Number of Memory::commit() calls. */
+    uint32_t failed_commits;        /**< Number of failed Memory::commit() calls. */
+    uint32_t commits_coalesced;     /**< Number of loop() passes whose commit was deferred by the commit policy. */
+    uint32_t last_flush_us;         /**< Duration of the last flush (writes and commit). */
+    MemoryStatsHistogram_t loop_us;   /**< Duration of loop(). */
+    MemoryStatsHistogram_t begin_us;  /**< Duration of begin(). */
+    MemoryStatsHistogram_t commit_us; /**< Duration of Memory::commit(). */
+};
+
+/**
+ * @class MemoryStats
+ * @brief Collects the counters of a MemoryManager.
+ *
+ * All methods are plain increments and compile to nothing if
+ * MEMORRY_STATS_ENABLED is false.
+ */
+class MemoryStats
+{
+public:
+    MemoryStats() { reset(); }
+
+    /**
+     * @brief Timestamp for the durations passed to the counters.
+     * @return MemoryTimer::now_us(), 0 without reading the timer if MEMORRY_STATS_ENABLED is false.
+     */
+    static uint32_t now_us(void)
+    {
+#if MEMORRY_STATS_ENABLED == true
+        return MemoryTimer::now_us();
+#else
+        return 0;
+#endif
+    }
+
+    void add_block(void)
+    {
+#if MEMORRY_STATS_ENABLED == true
+        m_block_stats.push_back(MemoryBlockStats_t{});
+#endif
+    }
+
+    void remove_block(uint16_t idx)
+    {
+#if MEMORRY_STATS_ENABLED == true
+        if (idx < m_block_stats.size())
+        {
+            m_block_stats.erase(m_block_stats.begin() + idx);
+        }
+#endif
+    }
+
+    void compared(uint16_t idx, uint32_t len)
+    {
+#if MEMORRY_STATS_ENABLED == true
+        m_stats.compares++;
+        m_stats.bytes_compared += len;
+        m_block_stats[idx].compares++;
+        m_block_stats[idx].bytes_compared += len;
+#endif
+    }
+
+    void written(uint16_t idx, uint32_t len, bool success)
+    {
+#if MEMORRY_STATS_ENABLED == true
+        m_stats.writes++;
+        m_block_stats[idx].writes++;
+        if (success)
+        {
+            m_stats.bytes_written += len;
+            m_block_stats[idx].bytes_written += len;
+        }
+        else
+        {
+            m_stats.failed_writes++;
+            m_block_stats[idx].failed_writes++;
+        }
+#endif
+    }
+
+    void committed(uint32_t duration_us, bool success)
+    {
+#if MEMORRY_STATS_ENABLED == true
+        m_stats.commits++;
+        m_stats.failed_commits += (success ? 0u : 1u);
+        m_stats.commit_us.add(duration_us);
+#endif
+    }
+
+    void coalesced(void)
+    {
+#if MEMORRY_STATS_ENABLED == true
+        m_stats.commits_coalesced++;
+#endif
+    }
+
+    void flushed(uint32_t duration_us)
+    {
+#if MEMORRY_STATS_ENABLED == true
+        m_stats.last_flush_us = duration_us;
+#endif
+    }
+
+    void looped(uint32_t duration_us)
+    {
+#if MEMORRY_STATS_ENABLED == true
+        m_stats.loop_us.add(duration_us);
+#endif
+    }
+
+    void started(uint32_t duration_us)
+    {
+#if MEMORRY_STATS_ENABLED == true
+        m_stats.begin_us.add(duration_us);
+#endif
+    }
+
+    /**
+     * @brief Returns a copy of the global counters.
+     */
+    MemoryManagerStats_t snapshot(void) const { return m_stats; }
+
+    /**
+     * @brief Returns a copy of the counters of a block (all zero for an invalid index).
+     */
+    MemoryBlockStats_t block_snapshot(uint16_t idx) const
+    {
+        MemoryBlockStats_t ret = {};
+#if MEMORRY_STATS_ENABLED == true
+        if (idx < m_block_stats.size())
+        {
+            ret = m_block_stats[idx];
+        }
+#endif
+        return ret;
+    }
+
+    /**
+     * @brief Clears all counters, the registered blocks are kept.
+     */
+    void reset(void)
+    {
+        m_stats = MemoryManagerStats_t{};
+        for (uint16_t i = 0; i < m_block_stats.size(); i++)
+        {
+            m_block_stats[i] = MemoryBlockStats_t{};
+        }
+    }
+
+private:
+    MemoryManagerStats_t m_stats;
+#if MEMORRY_BLOCK_CAPACITY > 0
+    MemoryStaticList<MemoryBlockStats_t, MEMORRY_BLOCK_CAPACITY + 1> m_block_stats;
+#else
+    std::vector<MemoryBlockStats_t> m_block_stats;
+#endif
+};
+
+#endif
@@ -2,13 +2,57 @@
 #define MEMORY_TIMER_H
 
 #include "stdio.h"
+#include <stdint.h>
+
+#if defined(ARDUINO)
+#include <Arduino.h>
+#else
+#include <chrono>
+#include <thread>
+#endif
 
 class MemoryTimer {
     public:
         MemoryTimer(uint32_t ms_time){}
 
+        /**
+         * @brief Returns a free running microsecond timestamp (wraps after ~71 minutes).
+         */
+        static uint32_t now_us(void)
+        {
+#if defined(ARDUINO)
+            return micros();
+#else
+            return static_cast<uint32_t>(std::chrono::duration_cast<std::chrono::microseconds>(
+                       std::chrono::steady_clock::now().time_since_epoch()).count());
+#endif
+        }
+
+        /**
+         * @brief Returns a free running millisecond timestamp.
+         */
+        static uint32_t now_ms(void)
+        {
+#if defined(ARDUINO)
+            return millis();
+#else
+            return static_cast<uint32_t>(std::chrono::duration_cast<std::chrono::milliseconds>(
+                       std::chrono::steady_clock::now().time_since_epoch()).count());
+#endif
+        }
 
+        /**
+         * @brief Gives other tasks (and the Wi-Fi stack of the ESP) the CPU while waiting.
+         */
+        static void relax(void)
+        {
+#if defined(ARDUINO)
+            yield();
+#else
+            std::this_thread::yield();
+#endif
+        }
 };
 
 
-#endif
\ No newline at end of file
+#endif
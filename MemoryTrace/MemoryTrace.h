@@ -0,0 +1,182 @@
+#ifndef MEMORY_TRACE_H
+#define MEMORY_TRACE_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include "../MemoryManager_Feature.h"
+
+/**
+ * @def MEMORY_TRACE_NO_BLOCK
+ * @brief Block index of events which are not related to a block.
+ */
+#define MEMORY_TRACE_NO_BLOCK 0xFFFFu
+
+/**
+ * @enum MemoryTraceEvent_e
+ * @brief Identifiers of the trace events. The values are part of the binary
+ *        format, new events have to be appended (see tools/memory_trace_decode.py).
+ */
+enum MemoryTraceEvent_e
+{
+    TRACE_OFFSET = 0x00,        /**< get_offest(): offset of a block calculated. */
+    TRACE_COPY,                 /**< copy_data(): bytes copied. */
+    TRACE_READ_ENTRY,           /**< Block data read from memory. */
+    TRACE_WRITE_REQUEST,        /**< write_all(): block differs from memory mirror. */
+    TRACE_WRITE_ENTRY,          /**< Block data written to memory. */
+    TRACE_WRITE_PARAMETER,      /**< Block parameter written to memory. */
+    TRACE_WRITE_ERROR,          /**< Memory::write() failed. */
+    TRACE_COMMIT,               /**< Memory::commit() called. */
+    TRACE_EVENT_COUNT
+};
+
+/**
+ * @brief One binary trace event (16 bytes, little endian on all supported targets).
+ */
+struct MemoryTraceRecord_t
+{
+    uint32_t timestamp_us;  /**< MemoryTimer::now_us() when the event was recorded. */
+    uint32_t offset;        /**< Memory offset of the event. */
+    uint32_t len;           /**< Number of bytes. */
+    uint16_t block;         /**< Block index or MEMORY_TRACE_NO_BLOCK. */
+    uint8_t event;          /**< MemoryTraceEvent_e. */
+    uint8_t reserved;
+};
+
+/**
+ * @brief Returns the name of a trace event.
+ */
+inline static const char *MemoryTrace_event_name(uint8_t event)
+{
+    static const char *const names[TRACE_EVENT_COUNT] = {
+        "OFFSET", "COPY", "READ_ENTRY", "WRITE_REQUEST", "WRITE_ENTRY", "WRITE_PARAMETER", "WRITE_ERROR", "COMMIT"};
+    return (event < TRACE_EVENT_COUNT) ? names[event] : "UNKNOWN";
+}
+
+/**
+ * @brief Formats a trace event as text, e.g. on the host after reading a dump.
+ * @return Number of characters written (see snprintf).
+ */
+inline static int MemoryTrace_format(const MemoryTraceRecord_t &record, char *buffer, size_t size)
+{
+    return snprintf(buffer, size, "%10lu us  %-15s block=%u offset=%lu len=%lu",
+                    (unsigned long)record.timestamp_us, MemoryTrace_event_name(record.event),
+                    (unsigned)record.block, (unsigned long)record.offset, (unsigned long)record.len);
+}
+
+#if MEMORRY_TRACE_ENABLED == true
+#include <atomic>
+#include "../MemoryTimer/MemoryTimer.h"
+
+/**
+ * @class MemoryTrace
+ * @brief Fixed size, lock free ring buffer of binary trace events.
+ *
+ * Any number of producers may record events (a slot is claimed with one
+ * atomic increment), a single consumer drains them. If the consumer is too
+ * slow the oldest events are overwritten and counted as dropped.
+ */
+class MemoryTrace
+{
+public:
+    /**
+     * @brief Returns the global trace buffer.
+     */
+    static MemoryTrace &instance(void)
+    {
+        static MemoryTrace trace;
+        return trace;
+    }
+
+    /**
+     * @brief Records an event.
+     */
+    void record(MemoryTraceEvent_e event, uint16_t block, uint32_t offset, uint32_t len)
+    {
+        uint32_t idx = m_head.fetch_add(1u, std::memory_order_relaxed);
+        Slot_t &slot = m_slots[idx & (MEMORRY_TRACE_BUFFER_SIZE - 1u)];
+
+        slot.seq.store(0u, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        slot.record.timestamp_us = MemoryTimer::now_us();
+        slot.record.offset = offset;
+        slot.record.len = len;
+        slot.record.block = block;
+        slot.record.event = static_cast<uint8_t>(event);
+        slot.record.reserved = 0u;
+        slot.seq.store(idx + 1u, std::memory_order_release);
+    }
+
+    /**
+     * @brief Copies the recorded events into a buffer and removes them from the ring.
+     * @param records Destination buffer.
+     * @param max_records Size of the destination buffer.
+     * @return Number of events copied.
+     */
+    uint16_t drain(MemoryTraceRecord_t *records, uint16_t max_records)
+    {
+        uint16_t count = 0;
+        uint32_t head = m_head.load(std::memory_order_acquire);
+
+        if (head - m_tail > MEMORRY_TRACE_BUFFER_SIZE)
+        {
+            m_dropped += head - m_tail - MEMORRY_TRACE_BUFFER_SIZE;
+            m_tail = head - MEMORRY_TRACE_BUFFER_SIZE;
+        }
+
+        while ((m_tail != head) && (count < max_records))
+        {
+            Slot_t &slot = m_slots[m_tail & (MEMORRY_TRACE_BUFFER_SIZE - 1u)];
+
+            if (slot.seq.load(std::memory_order_acquire) != m_tail + 1u)
+            {
+                break; /* Producer has not finished this slot yet */
+            }
+            records[count] = slot.record;
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (slot.seq.load(std::memory_order_relaxed) == m_tail + 1u)
+            {
+                count++;
+            }
+            else
+            {
+                m_dropped++; /* Overwritten while copying */
+            }
+            m_tail++;
+        }
+        return count;
+    }
+
+    /**
+     * @brief Returns the number of events lost because the ring overflowed.
+     */
+    uint32_t dropped(void) const { return m_dropped; }
+
+private:
+    struct Slot_t
+    {
+        std::atomic<uint32_t> seq;
+        MemoryTraceRecord_t record;
+    };
+
+    MemoryTrace() : m_head(0u), m_tail(0u), m_dropped(0u)
+    {
+        static_assert((MEMORRY_TRACE_BUFFER_SIZE & (MEMORRY_TRACE_BUFFER_SIZE - 1u)) == 0u,
+                      "MEMORRY_TRACE_BUFFER_SIZE must be a power of two");
+        for (uint32_t i = 0; i < MEMORRY_TRACE_BUFFER_SIZE; i++)
+        {
+            m_slots[i].seq.store(0u, std::memory_order_relaxed);
+        }
+    }
+
+    Slot_t m_slots[MEMORRY_TRACE_BUFFER_SIZE];
+    std::atomic<uint32_t> m_head;
+    uint32_t m_tail;
+    uint32_t m_dropped;
+};
+
+#define MEMORY_TRACE(event, block, offset, len) MemoryTrace::instance().record((event), (block), (offset), (len))
+#else
+#define MEMORY_TRACE(event, block, offset, len) do {} while (0)
+#endif
+
+#endif
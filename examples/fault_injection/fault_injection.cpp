@@ -0,0 +1,232 @@
+/*
+ * Power cut harness for host builds.
+ *
+ * Runs random workloads through a MemoryManager on top of Fault_Memory and
+ * Host_Memory. Every cycle arms a power cut at a random write, byte or
+ * commit, updates random blocks until the power is gone and restarts the
+ * manager. After each recovery every block is checked:
+ *
+ *   - its record is intact, not a mix of two updates (torn record),
+ *   - it is not older than the last committed update (lost commit),
+ *   - it is not newer than the last update (phantom record).
+ *
+ * Blocks reset to their defaults by the verification of begin() are counted
+ * separately. At the end the begin() recovery latency and the number of
+ * updates lost by the cuts are printed, the exit code is 1 if a check failed.
+ *
+ * Build on the host with the dependencies of the library on the include path:
+ *
+ *   g++ -std=gnu++17 -I. -IMemory -pthread examples/fault_injection/fault_injection.cpp \
+ *       MemoryManager.cpp MemoryManager_Internal.cpp Memory/Host_Memory.cpp Memory/Fault_Memory.cpp
+ *
+ * Usage: fault_injection [cycles] [seed] [page_size] [lose_uncommitted]
+ */
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "MemoryManager.h"
+#include "Memory/Fault_Memory.h"
+#include "Memory/Host_Memory.h"
+
+#define BLOCK_COUNT         8u
+#define PASSES_PER_CYCLE    16u
+#define MEMORY_SIZE         4096u
+
+struct Record_t
+{
+    uint32_t seq;           /**< Number of the update, 0 for the defaults. */
+    uint32_t value[6];
+    uint32_t check;         /**< Checksum over seq and value. */
+};
+
+struct Result_t
+{
+    uint32_t cycles;
+    uint32_t updates;
+    uint32_t lost_updates;      /**< Uncommitted updates lost by a cut, expected. */
+    uint32_t torn_records;
+    uint32_t lost_commits;
+    uint32_t phantom_records;
+    uint32_t default_resets;
+    double begin_us_sum;
+    double begin_us_max;
+};
+
+static Record_t user_data[BLOCK_COUNT];
+static Record_t memory_data[BLOCK_COUNT];
+static Record_t default_data[BLOCK_COUNT];
+static MemoryManagerBlock blocks[BLOCK_COUNT];
+
+static Record_t recovered[BLOCK_COUNT];         /* Content found by the previous recovery */
+static uint32_t written_seq[BLOCK_COUNT];       /* Last update passed to the manager */
+static uint32_t committed_seq[BLOCK_COUNT];     /* Last update known to be committed */
+static uint32_t reports;
+
+static uint32_t checksum(const Record_t &record)
+{
+    uint32_t sum = 0x9E3779B9u ^ record.seq;
+
+    for (uint32_t i = 0; i < 6u; i++)
+    {
+        sum = (sum ^ record.value[i]) * 0x01000193u;
+    }
+    return sum;
+}
+
+static Record_t make_record(uint32_t seq)
+{
+    Record_t record;
+
+    record.seq = seq;
+    for (uint32_t i = 0; i < 6u; i++)
+    {
+        record.value[i] = (seq != 0) ? (uint32_t)rand() : 0u;
+    }
+    record.check = checksum(record);
+    return record;
+}
+
+static void report(const Result_t &result, uint32_t block, const char *what, uint32_t expected, uint32_t found)
+{
+    /* The counters tell the rest */
+    if (reports++ < 20u)
+    {
+        printf("cycle %u block %u: %s, expected %u, found %u\n", result.cycles, block, what, expected, found);
+    }
+}
+
+static void check_recovery(Result_t &result)
+{
+    for (uint32_t i = 0; i < BLOCK_COUNT; i++)
+    {
+        const Record_t &record = user_data[i];
+        bool changed = (memcmp(&record, &recovered[i], sizeof(Record_t)) != 0);
+
+        if (record.check != checksum(record))
+        {
+            /* A torn record stays until the block is written again, it is counted once */
+            if (changed)
+            {
+                report(result, i, "torn record", written_seq[i], record.seq);
+                result.torn_records++;
+            }
+            committed_seq[i] = 0;
+        }
+        else if ((record.seq == 0) && (committed_seq[i] != 0))
+        {
+            result.default_resets++;
+        }
+        else if (record.seq < committed_seq[i])
+        {
+            report(result, i, "committed update lost", committed_seq[i], record.seq);
+            result.lost_commits++;
+        }
+        else if (record.seq > written_seq[i])
+        {
+            report(result, i, "phantom update", written_seq[i], record.seq);
+            result.phantom_records++;
+        }
+
+        if (record.check == checksum(record))
+        {
+            result.lost_updates += (record.seq < written_seq[i]) ? (written_seq[i] - record.seq) : 0u;
+
+            /* The recovered state is the base of the next cycle, begin() has committed it */
+            written_seq[i] = record.seq;
+            committed_seq[i] = record.seq;
+        }
+        recovered[i] = record;
+    }
+}
+
+static void arm_fault(Fault_Memory &fault)
+{
+    switch (rand() % 3)
+    {
+        case 0:
+            fault.cut_after_writes(1u + rand() % 40u);
+            break;
+        case 1:
+            fault.cut_after_bytes(1u + rand() % 1024u);
+            break;
+        default:
+            fault.cut_at_commit(1u + rand() % 8u);
+            break;
+    }
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t cycles = (argc > 1) ? strtoul(argv[1], NULL, 0) : 1000u;
+    uint32_t seed = (argc > 2) ? strtoul(argv[2], NULL, 0) : 1u;
+    uint32_t page_size = (argc > 3) ? strtoul(argv[3], NULL, 0) : 16u;
+    bool lose_uncommitted = (argc > 4) ? (atoi(argv[4]) != 0) : false;
+    Host_Memory_Config_t host_config{MEMORY_SIZE, 0, 0};
+    Host_Memory host(host_config);
+    Fault_Memory_Config_t fault_config{&host, page_size, lose_uncommitted, seed};
+    Fault_Memory fault(fault_config);
+    MemoryManagerConfig_t config = {};
+    Result_t result = {};
+    std::chrono::steady_clock::time_point start;
+    double begin_us;
+    uint32_t idx;
+
+    config.version.str.patch = 1;
+    config.storage = blocks;
+    config.number_of_storage = BLOCK_COUNT;
+
+    srand(seed);
+    for (uint32_t i = 0; i < BLOCK_COUNT; i++)
+    {
+        default_data[i] = make_record(0);
+        blocks[i] = MemoryManagerBlock(reinterpret_cast<uint8_t *>(&user_data[i]),
+                                       reinterpret_cast<uint8_t *>(&memory_data[i]),
+                                       sizeof(Record_t),
+                                       reinterpret_cast<uint8_t *>(&default_data[i]),
+                                       MemoryBlockWrite_e::WRITE_ON_CHANGE);
+    }
+
+    for (result.cycles = 0; result.cycles < cycles; result.cycles++)
+    {
+        fault.power_on();
+        MemoryManager manager(fault, config);
+
+        start = std::chrono::steady_clock::now();
+        manager.begin();
+        begin_us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+        result.begin_us_sum += begin_us;
+        result.begin_us_max = (begin_us > result.begin_us_max) ? begin_us : result.begin_us_max;
+        check_recovery(result);
+
+        arm_fault(fault);
+        for (uint32_t pass = 0; (pass < PASSES_PER_CYCLE) && fault.powered(); pass++)
+        {
+            for (uint32_t n = 1u + rand() % 3u; n > 0; n--)
+            {
+                idx = rand() % BLOCK_COUNT;
+                written_seq[idx]++;
+                manager.set_block_data(idx + 1u, make_record(written_seq[idx]));
+                result.updates++;
+            }
+
+            /* Every pass commits, a pass which keeps the power makes all updates durable */
+            manager.loop();
+            for (uint32_t i = 0; (i < BLOCK_COUNT) && fault.powered(); i++)
+            {
+                committed_seq[i] = written_seq[i];
+            }
+        }
+        fault.cut_after_writes(0);
+        fault.cut_after_bytes(0);
+        fault.cut_at_commit(0);
+    }
+
+    printf("cycles %u, updates %u, cuts %u (torn bytes %u, rolled back bytes %u)\n",
+           result.cycles, result.updates, fault.stats().cuts, fault.stats().torn_bytes, fault.stats().lost_bytes);
+    printf("begin() avg %.1f us, max %.1f us\n", result.begin_us_sum / result.cycles, result.begin_us_max);
+    printf("lost uncommitted updates %u, blocks reset to defaults %u\n", result.lost_updates, result.default_resets);
+    printf("torn records %u, lost commits %u, phantom records %u\n", result.torn_records, result.lost_commits, result.phantom_records);
+
+    return ((result.torn_records + result.lost_commits + result.phantom_records) > 0) ? 1 : 0;
+}
@@ -0,0 +1,141 @@
+/*
+ * Large device benchmark for host builds.
+ *
+ * Creates a sparse image file of almost 4 GiB through File_Memory and runs a
+ * MemoryManager in a partition at the end of it, above the 2 GiB a 32 bit
+ * long offset can reach. Each round updates all blocks, flushes them with
+ * loop() and restarts the manager. After every restart the blocks are
+ * compared with the last update, so offsets which wrapped around show up as
+ * mismatches. At the end the average begin(), loop() and raw read/write
+ * latencies at the start and at the end of the device are printed, the exit
+ * code is 1 if a check failed.
+ *
+ * Build on the host with the dependencies of the library on the include path:
+ *
+ *   g++ -std=gnu++17 -I. -IMemory examples/large_device/large_device.cpp \
+ *       MemoryManager.cpp MemoryManager_Internal.cpp Memory/File_Memory.cpp Memory/Partition_Memory.cpp
+ *
+ * Add -DMEMORRY_BULK_READ_ENABLED=false to compare begin() with the per block
+ * reads.
+ *
+ * Usage: large_device [image path] [rounds]
+ *
+ * The image is sparse, only the touched pages take space on the disk.
+ */
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "MemoryManager.h"
+#include "Memory/File_Memory.h"
+#include "Memory/Partition_Memory.h"
+
+#define BLOCK_COUNT         16u
+#define BLOCK_SIZE          128u
+#define DEVICE_SIZE         0xFFFFF000u
+#define PARTITION_SIZE      0x10000u
+#define RAW_ACCESSES        256u
+
+struct Timing_t
+{
+    double begin_us;
+    double loop_us;
+    double raw_low_us;          /**< Raw write and read at the start of the device. */
+    double raw_high_us;         /**< Raw write and read above 2 GiB. */
+};
+
+static uint8_t user_data[BLOCK_COUNT][BLOCK_SIZE];
+static uint8_t memory_data[BLOCK_COUNT][BLOCK_SIZE];
+static uint8_t default_data[BLOCK_COUNT][BLOCK_SIZE];
+static uint8_t expected[BLOCK_COUNT][BLOCK_SIZE];
+static MemoryManagerBlock blocks[BLOCK_COUNT];
+
+static double elapsed_us(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+}
+
+static double raw_access(Memory &memory, MemoryAddress_t base, uint32_t &errors)
+{
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    uint8_t out[BLOCK_SIZE];
+    uint8_t in[BLOCK_SIZE];
+    MemoryAddress_t address;
+
+    for (uint32_t i = 0; i < RAW_ACCESSES; i++)
+    {
+        address = base + i * BLOCK_SIZE;
+        memset(out, (int)(i ^ (address >> 24)), sizeof(out));
+        memory.write(out, address, sizeof(out));
+        if ((memory.read(in, address, sizeof(in)) != sizeof(in)) || (memcmp(in, out, sizeof(in)) != 0))
+        {
+            errors++;
+        }
+    }
+    memory.commit();
+    return elapsed_us(start) / RAW_ACCESSES;
+}
+
+int main(int argc, char **argv)
+{
+    const char *path = (argc > 1) ? argv[1] : "large_device.img";
+    uint32_t rounds = (argc > 2) ? strtoul(argv[2], NULL, 0) : 20u;
+    File_Memory_Config_t file_config{path, DEVICE_SIZE};
+    File_Memory file(file_config);
+    Partition_Memory_Config_t partitions[] = {{0u, PARTITION_SIZE}, {DEVICE_SIZE - PARTITION_SIZE, PARTITION_SIZE}};
+    Partition_Table table(file, DEVICE_SIZE, partitions, 2u);
+    Partition_Memory high(table, 1u);
+    MemoryManagerConfig_t config = {};
+    Timing_t timing = {};
+    std::chrono::steady_clock::time_point start;
+    uint32_t errors = 0;
+
+    config.version.str.patch = 1;
+    config.storage = blocks;
+    config.number_of_storage = BLOCK_COUNT;
+
+    for (uint32_t i = 0; i < BLOCK_COUNT; i++)
+    {
+        /* Defaults which differ from the blank image, so a new image is formatted */
+        memset(default_data[i], 0xA5, BLOCK_SIZE);
+        blocks[i] = MemoryManagerBlock(user_data[i], memory_data[i], BLOCK_SIZE, default_data[i], MemoryBlockWrite_e::WRITE_ON_CHANGE);
+    }
+
+    table.init();
+    timing.raw_low_us = raw_access(file, 0u, errors);
+    timing.raw_high_us = raw_access(file, DEVICE_SIZE - 2u * PARTITION_SIZE, errors);
+
+    for (uint32_t round = 0; round < rounds; round++)
+    {
+        MemoryManager manager(high, config);
+
+        start = std::chrono::steady_clock::now();
+        manager.begin();
+        timing.begin_us += elapsed_us(start);
+
+        /* The first round finds the content of a previous run */
+        if ((round > 0) && (memcmp(user_data, expected, sizeof(expected)) != 0))
+        {
+            printf("round %u: blocks differ from the last update\n", round);
+            errors++;
+        }
+
+        for (uint32_t i = 0; i < BLOCK_COUNT; i++)
+        {
+            memset(user_data[i], (int)(round * BLOCK_COUNT + i + 1u), BLOCK_SIZE);
+        }
+        memcpy(expected, user_data, sizeof(expected));
+
+        start = std::chrono::steady_clock::now();
+        manager.loop();
+        timing.loop_us += elapsed_us(start);
+    }
+
+    printf("device %u bytes, partition at 0x%08X, %u rounds of %u blocks of %u bytes\n",
+           DEVICE_SIZE, partitions[1].base, rounds, BLOCK_COUNT, BLOCK_SIZE);
+    printf("begin() avg %.1f us, loop() avg %.1f us\n", timing.begin_us / rounds, timing.loop_us / rounds);
+    printf("raw write+read of %u bytes: low %.1f us, above 2 GiB %.1f us\n", BLOCK_SIZE, timing.raw_low_us, timing.raw_high_us);
+    printf("errors %u\n", errors);
+
+    return (errors > 0) ? 1 : 0;
+}
@@ -0,0 +1,75 @@
+#!/usr/bin/env python3
+"""Converts a factory image into a C header for MemoryManagerConfig_t::factory_image.
+
+The image is written by a host build of the block configuration:
+
+    std::vector<uint8_t> image(manager.factory_image_size());
+    manager.factory_image(image.data(), image.size());
+
+and can be embedded into the firmware, or pre-flashed without its 12 byte
+trailer (magic, layout hash, image CRC):
+
+    memory_factory_image.py factory.bin memory_factory_image.h [symbol]
+
+The image CRC of the trailer is checked before the header is written, the
+layout hash is checked by the target against its block configuration.
+"""
+import struct
+import sys
+import zlib
+
+COLUMNS = 16
+TRAILER = struct.Struct("<III")
+MAGIC = 0x46494D47  # "FIMG"
+
+
+def check_image(image):
+    """Returns an error message if the trailer is missing or the CRC does not match."""
+    if len(image) <= TRAILER.size:
+        return "image too short"
+    magic, _, image_crc = TRAILER.unpack(image[-TRAILER.size:])
+    if magic != MAGIC:
+        return "no factory image trailer"
+    if image_crc != zlib.crc32(image[:-TRAILER.size]) & 0xFFFFFFFF:
+        return "image CRC mismatch"
+    return None
+
+
+def to_header(image, symbol):
+    lines = [
+        "/* Generated by tools/memory_factory_image.py, do not edit */",
+        "#ifndef %s_H" % symbol.upper(),
+        "#define %s_H" % symbol.upper(),
+        "#include <stdint.h>",
+        "",
+        "static const uint8_t %s[%d] = {" % (symbol, len(image)),
+    ]
+    for pos in range(0, len(image), COLUMNS):
+        lines.append("    " + " ".join("0x%02X," % value for value in image[pos:pos + COLUMNS]))
+    lines += [
+        "};",
+        "",
+        "#endif",
+        "",
+    ]
+    return "\n".join(lines)
+
+
+def main():
+    if len(sys.argv) not in (3, 4):
+        sys.stderr.write(__doc__)
+        return 1
+    symbol = sys.argv[3] if len(sys.argv) == 4 else "memory_factory_image"
+    with open(sys.argv[1], "rb") as image:
+        data = image.read()
+    error = check_image(data)
+    if error is not None:
+        sys.stderr.write("%s: %s\n" % (sys.argv[1], error))
+        return 1
+    with open(sys.argv[2], "w") as header:
+        header.write(to_header(data, symbol))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
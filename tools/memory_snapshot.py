@@ -0,0 +1,126 @@
+#!/usr/bin/env python3
+"""Inspects and validates a snapshot written by MemoryManager::export_snapshot().
+
+    memory_snapshot.py snapshot.bin                 print header and directory, verify all CRCs
+    memory_snapshot.py snapshot.bin image.bin       additionally extract the raw memory image
+
+Exits with 1 if the snapshot is invalid.
+"""
+import struct
+import sys
+import zlib
+
+# Must match MemorySnapshot/MemorySnapshot.h
+MAGIC = 0x4D534E50
+END_MAGIC = 0x53454E44
+FORMAT = 1
+
+HEADER = struct.Struct("<IHHIIHHI")
+DIR_ENTRY = struct.Struct("<III")
+CHUNK = struct.Struct("<II")
+TRAILER = struct.Struct("<II")
+CRC = struct.Struct("<I")
+
+
+class SnapshotError(Exception):
+    pass
+
+
+class Reader:
+    def __init__(self, data):
+        self.data = data
+        self.pos = 0
+
+    def take(self, size):
+        if self.pos + size > len(self.data):
+            raise SnapshotError("truncated at offset %d" % self.pos)
+        part = self.data[self.pos:self.pos + size]
+        self.pos += size
+        return part
+
+
+def crc32(data, crc=0):
+    return zlib.crc32(data, crc) & 0xFFFFFFFF
+
+
+def parse(data):
+    reader = Reader(data)
+
+    raw = reader.take(HEADER.size)
+    magic, fmt, block_count, version, image_size, chunk_size, params_size, crc = HEADER.unpack(raw)
+    if magic != MAGIC:
+        raise SnapshotError("no snapshot (magic 0x%08X)" % magic)
+    if fmt != FORMAT:
+        raise SnapshotError("unsupported format %d" % fmt)
+    if crc != crc32(raw[:-CRC.size]):
+        raise SnapshotError("header crc mismatch")
+    header = {
+        "version": "%d.%d.%d" % ((version >> 16) & 0xFF, (version >> 8) & 0xFF, version & 0xFF),
+        "blocks": block_count,
+        "image_size": image_size,
+        "chunk_size": chunk_size,
+        "params_size": params_size,
+    }
+
+    directory = []
+    directory_crc = 0
+    for _ in range(block_count):
+        raw = reader.take(DIR_ENTRY.size)
+        directory_crc = crc32(raw, directory_crc)
+        directory.append(DIR_ENTRY.unpack(raw))
+    if CRC.unpack(reader.take(CRC.size))[0] != directory_crc:
+        raise SnapshotError("directory crc mismatch")
+
+    image = bytearray()
+    while len(image) < image_size:
+        raw = reader.take(CHUNK.size)
+        offset, length = CHUNK.unpack(raw)
+        if offset != len(image) or length == 0 or length > chunk_size:
+            raise SnapshotError("chunk out of sequence at image offset %d" % len(image))
+        payload = reader.take(length)
+        if CRC.unpack(reader.take(CRC.size))[0] != crc32(payload, crc32(raw)):
+            raise SnapshotError("chunk crc mismatch at image offset %d" % offset)
+        image += payload
+
+    magic, image_crc = TRAILER.unpack(reader.take(TRAILER.size))
+    if magic != END_MAGIC or image_crc != crc32(bytes(image)):
+        raise SnapshotError("trailer invalid or image crc mismatch")
+    if len(image) != image_size:
+        raise SnapshotError("image size %d, expected %d" % (len(image), image_size))
+
+    return header, directory, bytes(image)
+
+
+def main():
+    if len(sys.argv) not in (2, 3):
+        sys.stderr.write(__doc__)
+        return 1
+    with open(sys.argv[1], "rb") as snapshot:
+        data = snapshot.read()
+
+    try:
+        header, directory, image = parse(data)
+    except SnapshotError as error:
+        print("INVALID: %s" % error)
+        return 1
+
+    print("version %s, %d blocks, image %d bytes, chunks of %d bytes, params %d bytes" % (
+        header["version"], header["blocks"], header["image_size"], header["chunk_size"], header["params_size"]))
+
+    valid = True
+    for idx, (offset, length, crc) in enumerate(directory):
+        block = image[offset:offset + length + header["params_size"]]
+        ok = (len(block) == length + header["params_size"]) and (crc32(block) == crc)
+        valid = valid and ok
+        print("block %3d  offset %8d  length %6d  crc 0x%08X  %s" % (idx, offset, length, crc, "ok" if ok else "CRC MISMATCH"))
+
+    if len(sys.argv) == 3:
+        with open(sys.argv[2], "wb") as out:
+            out.write(image)
+
+    print("valid" if valid else "INVALID: block crc mismatch")
+    return 0 if valid else 1
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,47 @@
+#!/usr/bin/env python3
+"""Decodes a binary dump of MemoryTraceRecord_t events into text.
+
+The dump is the raw content of the records returned by MemoryTrace::drain(),
+e.g. written with Serial.write() and captured on the host:
+
+    memory_trace_decode.py trace.bin
+"""
+import struct
+import sys
+
+# Must match MemoryTraceEvent_e in MemoryTrace/MemoryTrace.h
+EVENTS = [
+    "OFFSET",
+    "COPY",
+    "READ_ENTRY",
+    "WRITE_REQUEST",
+    "WRITE_ENTRY",
+    "WRITE_PARAMETER",
+    "WRITE_ERROR",
+    "COMMIT",
+]
+
+RECORD = struct.Struct("<IIIHBB")
+NO_BLOCK = 0xFFFF
+
+
+def decode(data):
+    for pos in range(0, len(data) - RECORD.size + 1, RECORD.size):
+        timestamp, offset, length, block, event, _ = RECORD.unpack_from(data, pos)
+        name = EVENTS[event] if event < len(EVENTS) else "UNKNOWN(%d)" % event
+        block_text = "-" if block == NO_BLOCK else str(block)
+        yield "%10d us  %-15s block=%s offset=%d len=%d" % (timestamp, name, block_text, offset, length)
+
+
+def main():
+    if len(sys.argv) != 2:
+        sys.stderr.write(__doc__)
+        return 1
+    with open(sys.argv[1], "rb") as dump:
+        for line in decode(dump.read()):
+            print(line)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())